@@ -22,10 +22,17 @@ namespace odb
     class LIBODB_MYSQL_EXPORT binding
     {
     public:
-      binding (): bind (0), count (0), version (0) {}
+      binding (): bind (0), count (0), version (0),
+                  batch (0), skip (0), status (0) {}
 
       binding (MYSQL_BIND* b, std::size_t n)
-          : bind (b), count (n), version (0)
+          : bind (b), count (n), version (0), batch (1), skip (0), status (0)
+      {
+      }
+
+      binding (MYSQL_BIND* b, std::size_t n,
+               std::size_t bt, std::size_t s, unsigned long long* st)
+          : bind (b), count (n), version (0), batch (bt), skip (s), status (st)
       {
       }
 
@@ -33,6 +40,19 @@ namespace odb
       std::size_t count;
       std::size_t version;
 
+      // Batch support. MySQL has no array binding so for parameters each
+      // set in the batch normally has its own bind entries which follow
+      // those of the previous set (that is, set i starts at bind + i *
+      // count). Alternatively, if skip is not 0, then there is only one
+      // set of bind entries and the buffers for set i are found skip * i
+      // bytes after those for set 0. This layout is used for the object
+      // id image which is both a parameter (for example, in erase) and
+      // a value returned by the statement itself (auto-assigned id).
+      //
+      std::size_t batch;
+      std::size_t skip;
+      unsigned long long* status; // Batch status array.
+
     private:
       binding (const binding&);
       binding& operator= (const binding&);
@@ -0,0 +1,164 @@
+// file      : odb/mysql/column-result.cxx
+// license   : GNU GPL v2; see accompanying LICENSE file
+
+#include <cstring> // std::memset
+#include <cassert>
+
+#include <odb/mysql/connection.hxx>
+#include <odb/mysql/statement.hxx>
+#include <odb/mysql/column-result.hxx>
+
+using namespace std;
+
+namespace odb
+{
+  namespace mysql
+  {
+    // long_data_column
+    //
+    size_t long_data_column::
+    read (size_t offset, char* buffer, size_t n)
+    {
+      assert (statement_ != 0);
+
+      if (null_ || offset >= size_ || n == 0)
+        return 0;
+
+      if (n > size_ - offset)
+        n = size_ - offset;
+
+      statement_->fetch_column (column_, offset, buffer, n);
+      return n;
+    }
+
+    // column_result
+    //
+    column_result::
+    column_result (connection& c, const query_base& q)
+        : conn_ (c), query_ (q), end_ (false)
+    {
+    }
+
+    column_result::
+    ~column_result ()
+    {
+      if (statement_ != 0 && !end_)
+        statement_->free_result ();
+    }
+
+    void column_result::
+    column (long_data_column& v)
+    {
+      // Cannot add columns once the statement has been executed.
+      //
+      assert (statement_ == 0);
+
+      column_info c;
+      c.buffer_type = MYSQL_TYPE_BLOB;
+      c.is_unsigned = false;
+      c.values = 0;
+      c.append = 0;
+      c.long_data = &v;
+      columns_.push_back (c);
+    }
+
+    size_t column_result::
+    fetch (size_t n)
+    {
+      if (end_)
+        return 0;
+
+      if (statement_ == 0)
+      {
+        // Now that we know all the columns, set up the binding. Each
+        // column is fetched into its own slot and then appended to the
+        // array.
+        //
+        size_t cn (columns_.size ());
+        assert (cn != 0);
+
+        slots_.resize (cn);
+        bind_.resize (cn);
+        memset (&bind_[0], 0, sizeof (MYSQL_BIND) * cn);
+
+        for (size_t i (0); i != cn; ++i)
+        {
+          MYSQL_BIND& b (bind_[i]);
+          slot& s (slots_[i]);
+
+          b.buffer_type = columns_[i].buffer_type;
+          b.is_unsigned = columns_[i].is_unsigned;
+          b.buffer = &s.value;
+
+          // For a long data column we only want the length so the value
+          // is always truncated.
+          //
+          b.buffer_length = columns_[i].long_data == 0 ? sizeof (s.value) : 0;
+          b.length = &s.length;
+          b.is_null = &s.is_null;
+          b.error = &s.error;
+        }
+
+        result_.bind = &bind_[0];
+        result_.count = cn;
+        result_.version++;
+
+        statement_.reset (
+          new (details::shared) select_statement (
+            conn_,
+            query_.clause (),
+            false,
+            false,
+            query_.parameters_binding (),
+            result_,
+            true)); // Allow cursor.
+
+        query_.init_parameters ();
+        statement_->execute ();
+      }
+
+      size_t r (0);
+
+      for (; r != n; ++r)
+      {
+        // Fixed-length values cannot be truncated so only long data
+        // columns can be.
+        //
+        if (statement_->fetch () == select_statement::no_data)
+        {
+          statement_->free_result ();
+          end_ = true;
+
+          for (size_t i (0); i != columns_.size (); ++i)
+          {
+            if (long_data_column* l = columns_[i].long_data)
+            {
+              l->null_ = true;
+              l->size_ = 0;
+            }
+          }
+
+          break;
+        }
+
+        for (size_t i (0); i != columns_.size (); ++i)
+        {
+          const column_info& c (columns_[i]);
+          const slot& s (slots_[i]);
+
+          if (long_data_column* l = c.long_data)
+          {
+            l->statement_ = statement_.get ();
+            l->column_ = static_cast<unsigned int> (i);
+            l->null_ = s.is_null != 0;
+            l->size_ = l->null_ ? 0 : s.length;
+          }
+          else
+            c.append (c.values, &s.value, s.is_null != 0);
+        }
+      }
+
+      return r;
+    }
+  }
+}
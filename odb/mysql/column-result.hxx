@@ -0,0 +1,317 @@
+// file      : odb/mysql/column-result.hxx
+// license   : GNU GPL v2; see accompanying LICENSE file
+
+#ifndef ODB_MYSQL_COLUMN_RESULT_HXX
+#define ODB_MYSQL_COLUMN_RESULT_HXX
+
+#include <odb/pre.hxx>
+
+#include <vector>
+#include <cstddef> // std::size_t
+
+#include <odb/details/shared-ptr.hxx>
+
+#include <odb/mysql/mysql.hxx>
+#include <odb/mysql/version.hxx>
+#include <odb/mysql/forward.hxx>
+#include <odb/mysql/traits.hxx>
+#include <odb/mysql/query.hxx>
+#include <odb/mysql/binding.hxx>
+
+#include <odb/mysql/details/export.hxx>
+
+namespace odb
+{
+  namespace mysql
+  {
+    // Values of a single result column in the image representation (see
+    // image_traits) plus the NULL bitmap. The value for a NULL entry is
+    // value-initialized.
+    //
+    template <database_type_id ID>
+    struct column_values
+    {
+      typedef typename image_traits<ID>::image_type value_type;
+
+      std::vector<value_type> values;
+      std::vector<bool> nulls;
+
+      std::size_t
+      size () const
+      {
+        return values.size ();
+      }
+
+      void
+      clear ()
+      {
+        values.clear ();
+        nulls.clear ();
+      }
+    };
+
+    // MySQL buffer type for the fixed-length database types. Only these
+    // types can be fetched column-wise.
+    //
+    template <database_type_id>
+    struct column_traits;
+
+    template <>
+    struct column_traits<id_tiny>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_TINY;
+      static const bool is_unsigned = false;
+    };
+
+    template <>
+    struct column_traits<id_utiny>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_TINY;
+      static const bool is_unsigned = true;
+    };
+
+    template <>
+    struct column_traits<id_short>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_SHORT;
+      static const bool is_unsigned = false;
+    };
+
+    template <>
+    struct column_traits<id_ushort>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_SHORT;
+      static const bool is_unsigned = true;
+    };
+
+    template <>
+    struct column_traits<id_long>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_LONG;
+      static const bool is_unsigned = false;
+    };
+
+    template <>
+    struct column_traits<id_ulong>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_LONG;
+      static const bool is_unsigned = true;
+    };
+
+    template <>
+    struct column_traits<id_longlong>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_LONGLONG;
+      static const bool is_unsigned = false;
+    };
+
+    template <>
+    struct column_traits<id_ulonglong>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_LONGLONG;
+      static const bool is_unsigned = true;
+    };
+
+    template <>
+    struct column_traits<id_float>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_FLOAT;
+      static const bool is_unsigned = false;
+    };
+
+    template <>
+    struct column_traits<id_double>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_DOUBLE;
+      static const bool is_unsigned = false;
+    };
+
+    template <>
+    struct column_traits<id_date>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_DATE;
+      static const bool is_unsigned = false;
+    };
+
+    template <>
+    struct column_traits<id_time>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_TIME;
+      static const bool is_unsigned = false;
+    };
+
+    template <>
+    struct column_traits<id_datetime>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_DATETIME;
+      static const bool is_unsigned = false;
+    };
+
+    template <>
+    struct column_traits<id_timestamp>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_TIMESTAMP;
+      static const bool is_unsigned = false;
+    };
+
+    template <>
+    struct column_traits<id_year>
+    {
+      static const enum_field_types buffer_type = MYSQL_TYPE_SHORT;
+      static const bool is_unsigned = false;
+    };
+
+    // BLOB or TEXT column that is not fetched with the row. Instead, its
+    // value can be read in chunks while the row is current, that is,
+    // until the next call to column_result::fetch(). Since only the last
+    // fetched row is current, the rows should be fetched one at a time.
+    // For example:
+    //
+    // column_values<id_longlong> ids;
+    // long_data_column data;
+    //
+    // column_result r (conn, query_base ("SELECT id, data FROM t"));
+    // r.column (ids);
+    // r.column (data);
+    //
+    // while (r.fetch (1) != 0)
+    // {
+    //   char buf[65536];
+    //
+    //   for (std::size_t o (0), n;
+    //        (n = data.read (o, buf, sizeof (buf))) != 0;
+    //        o += n)
+    //     ...
+    // }
+    //
+    class LIBODB_MYSQL_EXPORT long_data_column
+    {
+    public:
+      long_data_column (): statement_ (0), null_ (true), size_ (0) {}
+
+      bool
+      null () const
+      {
+        return null_;
+      }
+
+      // Size of the value in bytes.
+      //
+      std::size_t
+      size () const
+      {
+        return size_;
+      }
+
+      // Read up to n bytes of the value starting from the offset. Return
+      // the number of bytes read with 0 indicating the end of the value.
+      //
+      std::size_t
+      read (std::size_t offset, char* buffer, std::size_t n);
+
+    private:
+      friend class column_result;
+
+      select_statement* statement_;
+      unsigned int column_;
+      bool null_;
+      std::size_t size_;
+    };
+
+    // Fetch the result of a native SELECT query into column-major arrays,
+    // bypassing the per-object image and conversion. For example:
+    //
+    // column_values<id_longlong> ids;
+    // column_values<id_double> prices;
+    //
+    // column_result r (conn, query_base ("SELECT id, price FROM t"));
+    // r.column (ids);
+    // r.column (prices);
+    //
+    // while (r.fetch (1024) != 0)
+    // {
+    //   ...
+    //   ids.clear ();
+    //   prices.clear ();
+    // }
+    //
+    // The columns must be added in the SELECT-list order before the first
+    // call to fetch(). Similar to other results, unless the connection
+    // uses the server-side cursor mode, the result has to be fetched to
+    // the end (or the column_result destroyed) before another statement
+    // can be executed on the connection.
+    //
+    class LIBODB_MYSQL_EXPORT column_result
+    {
+    public:
+      column_result (connection&, const query_base&);
+
+      ~column_result ();
+
+      template <database_type_id ID>
+      void
+      column (column_values<ID>&);
+
+      void
+      column (long_data_column&);
+
+      // Fetch up to n rows appending the values to the column arrays.
+      // Return the number of rows fetched with 0 indicating the end of
+      // the result.
+      //
+      std::size_t
+      fetch (std::size_t n);
+
+    private:
+      column_result (const column_result&);
+      column_result& operator= (const column_result&);
+
+      template <database_type_id ID>
+      static void
+      append (void* values, const void* value, bool is_null);
+
+    private:
+      connection& conn_;
+      query_base query_;
+
+      struct column_info
+      {
+        enum_field_types buffer_type;
+        bool is_unsigned;
+        void* values;
+        void (*append) (void* values, const void* value, bool is_null);
+        long_data_column* long_data; // NULL if not a long data column.
+      };
+
+      // Buffer for a single value of any of the supported types.
+      //
+      struct slot
+      {
+        union
+        {
+          long long ll;
+          double d;
+          MYSQL_TIME t;
+        } value;
+
+        my_bool is_null;
+        my_bool error;
+        unsigned long length;
+      };
+
+      std::vector<column_info> columns_;
+      std::vector<slot> slots_;
+      std::vector<MYSQL_BIND> bind_;
+      binding result_;
+
+      details::shared_ptr<select_statement> statement_;
+      bool end_;
+    };
+  }
+}
+
+#include <odb/mysql/column-result.txx>
+
+#include <odb/post.hxx>
+
+#endif // ODB_MYSQL_COLUMN_RESULT_HXX
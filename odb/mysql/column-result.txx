@@ -0,0 +1,40 @@
+// file      : odb/mysql/column-result.txx
+// license   : GNU GPL v2; see accompanying LICENSE file
+
+#include <cassert>
+
+namespace odb
+{
+  namespace mysql
+  {
+    template <database_type_id ID>
+    void column_result::
+    column (column_values<ID>& v)
+    {
+      // Cannot add columns once the statement has been executed.
+      //
+      assert (statement_ == 0);
+
+      column_info c;
+      c.buffer_type = column_traits<ID>::buffer_type;
+      c.is_unsigned = column_traits<ID>::is_unsigned;
+      c.values = &v;
+      c.append = &append<ID>;
+      c.long_data = 0;
+      columns_.push_back (c);
+    }
+
+    template <database_type_id ID>
+    void column_result::
+    append (void* values, const void* value, bool is_null)
+    {
+      typedef typename column_values<ID>::value_type value_type;
+
+      column_values<ID>& v (*static_cast<column_values<ID>*> (values));
+
+      v.values.push_back (
+        is_null ? value_type () : *static_cast<const value_type*> (value));
+      v.nulls.push_back (is_null);
+    }
+  }
+}
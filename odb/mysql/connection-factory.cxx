@@ -8,12 +8,18 @@
 #  include <pthread.h>
 #endif
 
+#include <ctime>   // std::time
 #include <cstdlib> // abort
 
 #include <odb/details/tls.hxx>
 #include <odb/details/lock.hxx>
 
+#ifndef ODB_THREADS_NONE
+#  include <odb/details/thread.hxx>
+#endif
+
 #include <odb/mysql/mysql.hxx>
+#include <odb/mysql/database.hxx>
 #include <odb/mysql/connection-factory.hxx>
 #include <odb/mysql/exceptions.hxx>
 
@@ -50,12 +56,28 @@ namespace odb
     {
       static bool main_thread_init_;
 
+      // Each thread gets the next index in the order the threads first
+      // use the library. The connection pool uses it to spread the
+      // threads among the shards round-robin.
+      //
+      static mutex thread_index_mutex_;
+      static size_t thread_index_;
+
+      static size_t
+      next_thread_index ()
+      {
+        lock l (thread_index_mutex_);
+        return thread_index_++;
+      }
+
       struct mysql_thread_init
       {
-#ifndef ODB_THREADS_NONE
         mysql_thread_init ()
-            : init_ (false)
+            : index (next_thread_index ())
         {
+#ifndef ODB_THREADS_NONE
+          init_ = false;
+
           if (!main_thread_init_)
           {
             if (::mysql_thread_init ())
@@ -70,8 +92,10 @@ namespace odb
             value_ = pthread_getspecific (THR_KEY_mysys);
 #endif
           }
+#endif // ODB_THREADS_NONE
         }
 
+#ifndef ODB_THREADS_NONE
         ~mysql_thread_init ()
         {
           if (init_)
@@ -83,7 +107,11 @@ namespace odb
             mysql_thread_end ();
           }
         }
+#endif // ODB_THREADS_NONE
+
+        size_t index; // See next_thread_index().
 
+#ifndef ODB_THREADS_NONE
       private:
         bool init_;
 #if defined(ODB_THREADS_POSIX) && defined(LIBODB_MYSQL_THR_KEY_VISIBLE)
@@ -141,23 +169,98 @@ namespace odb
 
     // connection_pool_factory
     //
+
+    // Lock all the shards (in order, after the pool mutex).
+    //
+    struct connection_pool_factory::shards_lock
+    {
+      shards_lock (connection_pool_factory& f): f_ (f), locked_ (false)
+      {
+        lock ();
+      }
+
+      ~shards_lock ()
+      {
+        if (locked_)
+          unlock ();
+      }
+
+      void
+      lock ()
+      {
+        for (size_t i (0); i != shard_count; ++i)
+          f_.shards_[i].mutex.lock ();
+
+        locked_ = true;
+      }
+
+      void
+      unlock ()
+      {
+        for (size_t i (shard_count); i != 0; --i)
+          f_.shards_[i - 1].mutex.unlock ();
+
+        locked_ = false;
+      }
+
+      // Number of idle connections in all the shards.
+      //
+      size_t
+      idle () const
+      {
+        size_t r (0);
+        for (size_t i (0); i != shard_count; ++i)
+          r += f_.shards_[i].idle.size ();
+        return r;
+      }
+
+    private:
+      connection_pool_factory& f_;
+      bool locked_;
+    };
+
     connection_pool_factory::pooled_connection_ptr connection_pool_factory::
     create ()
     {
       return pooled_connection_ptr (new (shared) pooled_connection (*this));
     }
 
+    void connection_pool_factory::
+    stop_warmup ()
+    {
+      {
+        lock l (mutex_);
+        warmup_stop_ = true;
+      }
+
+#ifndef ODB_THREADS_NONE
+      for (size_t i (0); i != warmup_list_.size (); ++i)
+      {
+        warmup_list_[i]->join ();
+        delete warmup_list_[i];
+      }
+
+      warmup_list_.clear ();
+#endif
+    }
+
     connection_pool_factory::
     ~connection_pool_factory ()
     {
+      stop_warmup ();
+
       // Wait for all the connections currently in use to return to
       // the pool.
       //
       lock l (mutex_);
-      while (in_use_ != 0)
+      shards_lock sl (*this);
+
+      while (sl.idle () + connections_.size () != count_)
       {
         waiters_++;
+        sl.unlock ();
         cond_.wait (l);
+        sl.lock ();
         waiters_--;
       }
     }
@@ -165,7 +268,7 @@ namespace odb
     connection_ptr connection_pool_factory::
     connect ()
     {
-      tls_get (mysql_thread_init_);
+      size_t home (tls_get (mysql_thread_init_).index % shard_count);
 
       // The outer loop checks whether the connection we were
       // given is still valid.
@@ -173,48 +276,105 @@ namespace odb
       while (true)
       {
         pooled_connection_ptr c;
+        bool fresh (false);
 
-        lock l (mutex_);
-
-        // The inner loop tries to find a free connection.
+        // First try to get a spare connection without touching the pool
+        // mutex.
         //
-        while (true)
+        for (size_t i (0); i != shard_count && c == 0; ++i)
         {
-          // See if we have a spare connection.
-          //
-          if (connections_.size () != 0)
-          {
-            c = connections_.back ();
-            connections_.pop_back ();
+          shard& s (shards_[(home + i) % shard_count]);
+          lock sl (s.mutex);
 
-            c->callback_ = &c->cb_;
-            in_use_++;
-            break;
+          if (!s.idle.empty ())
+          {
+            c = s.idle.back ();
+            s.idle.pop_back ();
           }
+        }
+
+        if (c == 0)
+        {
+          lock l (mutex_);
 
-          // See if we can create a new one.
+          // The inner loop tries to find a free connection.
           //
-          if(max_ == 0 || in_use_ < max_)
+          while (true)
           {
-            // For new connections we don't need to ping so we
-            // can return immediately.
+            // See if someone has handed us a connection.
             //
-            c = create ();
-            c->callback_ = &c->cb_;
-            in_use_++;
-            return c;
-          }
+            if (!connections_.empty ())
+            {
+              c = connections_.back ();
+              connections_.pop_back ();
+              break;
+            }
 
-          // Wait until someone releases a connection.
-          //
-          waiters_++;
-          cond_.wait (l);
-          waiters_--;
+            // See if a connection was returned to one of the shards since
+            // we have checked.
+            //
+            shards_lock sl (*this);
+
+            for (size_t i (0); i != shard_count && c == 0; ++i)
+            {
+              connections& ic (shards_[i].idle);
+
+              if (!ic.empty ())
+              {
+                c = ic.back ();
+                ic.pop_back ();
+              }
+            }
+
+            if (c != 0)
+              break;
+
+            // See if we can create a new one.
+            //
+            if (max_ == 0 || count_ < max_)
+            {
+              sl.unlock ();
+              c = create ();
+              sl.lock ();
+              count_++;
+              fresh = true;
+              break;
+            }
+
+            // Wait until someone releases a connection. Once the waiters
+            // count is non-zero, released connections are handed over via
+            // connections_ (see release()).
+            //
+            waiters_++;
+            sl.unlock ();
+            cond_.wait (l);
+            sl.lock ();
+            waiters_--;
+          }
         }
 
-        l.unlock ();
+        c->callback_ = &c->cb_;
+        c->shard_ = home;
 
-        if (!ping_ || c->ping ())
+        // For new connections we don't need to ping. Neither do we need
+        // to ping a connection that has only been idle for a short time.
+        //
+        if (fresh)
+          return c;
+
+        time_t now (time (0));
+
+        if (max_lifetime_ != 0 &&
+            static_cast<size_t> (now - c->created_) >= max_lifetime_)
+        {
+          c->mark_failed (); // Will be deleted on release.
+          continue;
+        }
+
+        if (!ping_ ||
+            (ping_idle_ != 0 &&
+             static_cast<size_t> (now - c->used_) < ping_idle_) ||
+            c->ping ())
           return c;
       }
 
@@ -233,37 +393,193 @@ namespace odb
       if (!first)
         return;
 
-      if (min_ > 0)
+      if (min_ == 0)
+        return;
+
+#ifndef ODB_THREADS_NONE
+      if (warmup_threads_ != 0)
+      {
+        size_t n (warmup_threads_ < min_ ? warmup_threads_ : min_);
+        warmup_list_.reserve (n);
+
+        for (size_t i (0); i != n; ++i)
+        {
+          {
+            lock l (mutex_);
+            warmup_active_++;
+          }
+
+          try
+          {
+            warmup_list_.push_back (new thread (&warmup_thread, this));
+          }
+          catch (...)
+          {
+            lock l (mutex_);
+            warmup_active_--;
+            warmup_failed_ = true;
+
+            if (warmup_active_ == 0)
+              ready_cond_.signal ();
+
+            throw;
+          }
+        }
+
+        return;
+      }
+#endif
+
+      for(size_t i (0); i < min_; ++i)
+      {
+        pooled_connection_ptr c (create ());
+        c->shard_ = i % shard_count;
+        shards_[c->shard_].idle.push_back (c);
+        count_++;
+      }
+    }
+
+    void* connection_pool_factory::
+    warmup_thread (void* arg)
+    {
+      static_cast<connection_pool_factory*> (arg)->warmup_ ();
+      return 0;
+    }
+
+    void connection_pool_factory::
+    warmup_ ()
+    {
+      bool failed (false);
+
+      try
+      {
+        size_t home (tls_get (mysql_thread_init_).index % shard_count);
+
+        for (size_t i (0);; ++i)
+        {
+          // Reserve a slot so that connect() does not go over the maximum
+          // while we are establishing the connection.
+          //
+          {
+            lock l (mutex_);
+
+            if (warmup_stop_ || warmup_failed_ || count_ >= min_)
+              break;
+
+            shards_lock sl (*this);
+            count_++;
+          }
+
+          pooled_connection_ptr c;
+
+          try
+          {
+            c = create ();
+          }
+          catch (...)
+          {
+            lock l (mutex_);
+            shards_lock sl (*this);
+            count_--;
+            throw;
+          }
+
+          c->shard_ = (home + i) % shard_count;
+
+          connections cs (1, c);
+          lock l (mutex_);
+          shards_lock sl (*this);
+          put_ (cs);
+        }
+      }
+      catch (...)
+      {
+        failed = true;
+      }
+
+      bool done;
       {
-        connections_.reserve (min_);
+        lock l (mutex_);
+
+        if (failed)
+          warmup_failed_ = true;
 
-        for(size_t i (0); i < min_; ++i)
-          connections_.push_back (create ());
+        failed = warmup_failed_;
+        done = --warmup_active_ == 0;
+
+        if (done)
+          ready_cond_.signal ();
       }
+
+      if (done && warmup_callback_ != 0)
+        warmup_callback_ (*this, !failed, warmup_arg_);
+    }
+
+    bool connection_pool_factory::
+    ready ()
+    {
+      lock l (mutex_);
+      return warmup_active_ == 0;
+    }
+
+    bool connection_pool_factory::
+    wait_ready ()
+    {
+      lock l (mutex_);
+
+      while (warmup_active_ != 0)
+        ready_cond_.wait (l);
+
+      // Signal the next thread waiting for the warm-up, if any.
+      //
+      ready_cond_.signal ();
+
+      return !warmup_failed_;
     }
 
     bool connection_pool_factory::
     release (pooled_connection* c)
     {
       c->clear ();
+      c->reset_session ();
       c->callback_ = 0;
+      c->used_ = time (0);
+
+      // In the common case (nobody is waiting and we are not over the
+      // minimum) simply return the connection to its shard.
+      //
+      if (!c->failed ())
+      {
+        shard& s (shards_[c->shard_]);
+        lock sl (s.mutex);
+
+        if (waiters_ == 0 && (min_ == 0 || count_ <= min_))
+        {
+          s.idle.push_back (pooled_connection_ptr (inc_ref (c)));
+          s.idle.back ()->recycle ();
+          return false;
+        }
+      }
 
       lock l (mutex_);
+      shards_lock sl (*this);
 
       // Determine if we need to keep or free this connection.
       //
       bool keep (!c->failed () &&
-                 (waiters_ != 0 ||
-                  min_ == 0 ||
-                  (connections_.size () + in_use_ <= min_)));
-
-      in_use_--;
+                 (waiters_ != 0 || min_ == 0 || count_ <= min_));
 
       if (keep)
       {
-        connections_.push_back (pooled_connection_ptr (inc_ref (c)));
-        connections_.back ()->recycle ();
+        connections& cs (waiters_ != 0
+                         ? connections_
+                         : shards_[c->shard_].idle);
+
+        cs.push_back (pooled_connection_ptr (inc_ref (c)));
+        cs.back ()->recycle ();
       }
+      else
+        count_--;
 
       if (waiters_ != 0)
         cond_.signal ();
@@ -271,13 +587,294 @@ namespace odb
       return !keep;
     }
 
+    size_t connection_pool_factory::
+    reap ()
+    {
+      tls_get (mysql_thread_init_);
+
+      size_t r (0);
+
+      // Check the idle connections one at a time so that the rest of the
+      // pool stays available while we are pinging. We take connections
+      // from the front of each shard (those that have been idle the
+      // longest) and return the live ones to the back so that each is
+      // checked at most once unless connect() and release() reorder the
+      // shard in the meantime.
+      //
+      for (size_t si (0); si != shard_count; ++si)
+      {
+        shard& s (shards_[si]);
+
+        size_t n;
+        {
+          lock sl (s.mutex);
+          n = s.idle.size ();
+        }
+
+        for (; n != 0; --n)
+        {
+          pooled_connection_ptr c;
+          {
+            lock sl (s.mutex);
+
+            if (s.idle.empty ())
+              break;
+
+            c = s.idle.front ();
+            s.idle.erase (s.idle.begin ());
+          }
+
+          time_t now (time (0));
+
+          bool close (
+            (max_idle_ != 0 &&
+             static_cast<size_t> (now - c->used_) >= max_idle_) ||
+            (max_lifetime_ != 0 &&
+             static_cast<size_t> (now - c->created_) >= max_lifetime_));
+
+          if (!close && ping_)
+          {
+            try
+            {
+              close = !c->ping ();
+            }
+            catch (const database_exception&)
+            {
+              close = true;
+            }
+          }
+
+          if (!close)
+          {
+            // Unless someone is waiting for a connection, return it
+            // straight to its shard (see release()).
+            //
+            {
+              lock sl (s.mutex);
+
+              if (waiters_ == 0)
+              {
+                s.idle.push_back (c);
+                continue;
+              }
+            }
+
+            connections cs (1, c);
+            lock l (mutex_);
+            shards_lock sl (*this);
+            put_ (cs);
+            continue;
+          }
+
+          c.reset (); // Close the connection.
+          r++;
+
+          // Let a waiter, if any, create a new connection in place of
+          // the one we have closed.
+          //
+          lock l (mutex_);
+          shards_lock sl (*this);
+          count_--;
+
+          if (waiters_ != 0)
+            cond_.signal ();
+        }
+      }
+
+      // Top up the pool to the minimum.
+      //
+      connections cs;
+      size_t n;
+      {
+        lock l (mutex_);
+        shards_lock sl (*this);
+
+        n = count_ < min_ ? min_ - count_ : 0;
+        count_ += n; // Reserve.
+      }
+
+      for (size_t i (0); i != n; ++i)
+      {
+        pooled_connection_ptr c;
+
+        try
+        {
+          c = create ();
+        }
+        catch (...)
+        {
+          lock l (mutex_);
+          shards_lock sl (*this);
+          count_ -= n - i;
+          throw;
+        }
+
+        cs.assign (1, c);
+
+        lock l (mutex_);
+        shards_lock sl (*this);
+        put_ (cs);
+      }
+
+      return r;
+    }
+
+    void connection_pool_factory::
+    put_ (connections& cs)
+    {
+      for (connections::iterator i (cs.begin ()); i != cs.end (); ++i)
+      {
+        if (waiters_ != 0)
+        {
+          connections_.push_back (*i);
+          cond_.signal ();
+        }
+        else
+          shards_[(*i)->shard_].idle.push_back (*i);
+      }
+
+      cs.clear ();
+    }
+
+    // replica_pool_factory
+    //
+    replica_pool_factory::
+    ~replica_pool_factory ()
+    {
+      // The warm-up threads call our create().
+      //
+      stop_warmup ();
+    }
+
+    connection_pool_factory::pooled_connection_ptr replica_pool_factory::
+    create ()
+    {
+      return pooled_connection_ptr (
+        new (shared) pooled_connection (
+          *this,
+          host_.empty () ? 0 : host_.c_str (),
+          port_,
+          socket_.empty () ? 0 : socket_.c_str ()));
+    }
+
+    // routing_connection_factory
+    //
+    routing_connection_factory::
+    routing_connection_factory (transfer_ptr<connection_factory> primary,
+                                size_t retry)
+        : primary_ (primary.transfer ()), retry_ (retry), next_ (0)
+    {
+      assert (primary_ != 0);
+    }
+
+    routing_connection_factory::
+    ~routing_connection_factory ()
+    {
+      for (replicas::iterator i (replicas_.begin ());
+           i != replicas_.end ();
+           ++i)
+        delete i->factory;
+
+      delete primary_;
+    }
+
+    void routing_connection_factory::
+    replica (transfer_ptr<connection_factory> f)
+    {
+      replica_info r;
+      r.factory = f.get ();
+      r.down_until = 0;
+
+      replicas_.push_back (r);
+      f.transfer ();
+
+      if (db_ != 0)
+        r.factory->database (*db_);
+    }
+
+    bool routing_connection_factory::
+    replica_healthy (size_t i)
+    {
+      lock l (mutex_);
+      time_t d (replicas_[i].down_until);
+      return d == 0 || d <= time (0);
+    }
+
+    connection_ptr routing_connection_factory::
+    connect ()
+    {
+      return primary_->connect ();
+    }
+
+    connection_ptr routing_connection_factory::
+    connect_read_only ()
+    {
+      size_t n (replicas_.size ());
+
+      for (size_t k (0); k != n; ++k)
+      {
+        // Pick the next healthy replica.
+        //
+        size_t i;
+        {
+          lock l (mutex_);
+
+          time_t now (time (0));
+          for (i = 0; i != n; ++i)
+          {
+            replica_info& r (replicas_[(next_ + i) % n]);
+
+            if (r.down_until == 0 || r.down_until <= now)
+              break;
+          }
+
+          if (i == n)
+            break;
+
+          i = (next_ + i) % n;
+          next_ = (i + 1) % n;
+        }
+
+        try
+        {
+          connection_ptr c (replicas_[i].factory->connect ());
+
+          lock l (mutex_);
+          replicas_[i].down_until = 0;
+          return c;
+        }
+        catch (const database_exception&)
+        {
+          lock l (mutex_);
+          replicas_[i].down_until = time (0) + static_cast<time_t> (retry_);
+        }
+      }
+
+      // All the replicas are down.
+      //
+      return primary_->connect ();
+    }
+
+    void routing_connection_factory::
+    database (database_type& db)
+    {
+      connection_factory::database (db);
+
+      primary_->database (db);
+
+      for (replicas::iterator i (replicas_.begin ());
+           i != replicas_.end ();
+           ++i)
+        i->factory->database (db);
+    }
+
     //
     // connection_pool_factory::pooled_connection
     //
 
     connection_pool_factory::pooled_connection::
     pooled_connection (connection_pool_factory& f)
-        : connection (f)
+        : connection (f), shard_ (0), created_ (time (0)), used_ (created_)
     {
       cb_.arg = this;
       cb_.zero_counter = &zero_counter;
@@ -285,7 +882,24 @@ namespace odb
 
     connection_pool_factory::pooled_connection::
     pooled_connection (connection_pool_factory& f, MYSQL* handle)
-        : connection (f, handle)
+        : connection (f, handle),
+          shard_ (0),
+          created_ (time (0)),
+          used_ (created_)
+    {
+      cb_.arg = this;
+      cb_.zero_counter = &zero_counter;
+    }
+
+    connection_pool_factory::pooled_connection::
+    pooled_connection (connection_pool_factory& f,
+                       const char* host,
+                       unsigned int port,
+                       const char* socket)
+        : connection (f, host, port, socket),
+          shard_ (0),
+          created_ (time (0)),
+          used_ (created_)
     {
       cb_.arg = this;
       cb_.zero_counter = &zero_counter;
@@ -6,7 +6,9 @@
 
 #include <odb/pre.hxx>
 
+#include <string>
 #include <vector>
+#include <ctime>   // std::time_t
 #include <cstddef> // std::size_t
 #include <cassert>
 
@@ -17,11 +19,17 @@
 #include <odb/details/mutex.hxx>
 #include <odb/details/condition.hxx>
 #include <odb/details/shared-ptr.hxx>
+#include <odb/details/transfer-ptr.hxx>
 
 #include <odb/mysql/details/export.hxx>
 
 namespace odb
 {
+  namespace details
+  {
+    class thread;
+  }
+
   namespace mysql
   {
     class LIBODB_MYSQL_EXPORT new_connection_factory: public connection_factory
@@ -63,15 +71,95 @@ namespace odb
           : max_ (max_connections),
             min_ (min_connections),
             ping_ (ping),
-            in_use_ (0),
+            ping_idle_ (0),
+            max_idle_ (0),
+            max_lifetime_ (0),
+            warmup_threads_ (0),
+            warmup_callback_ (0),
+            warmup_arg_ (0),
+            warmup_active_ (0),
+            warmup_failed_ (false),
+            warmup_stop_ (false),
+            count_ (0),
             waiters_ (0),
-            cond_ (mutex_)
+            cond_ (mutex_),
+            ready_cond_ (mutex_)
       {
         // max_connections == 0 means unlimited.
         //
         assert (max_connections == 0 || max_connections >= min_connections);
       }
 
+      // Only ping a connection being returned to the caller if it has
+      // been idle in the pool for at least this many seconds. If this
+      // value is 0 (default), then the connection is pinged every time
+      // (provided pinging is enabled).
+      //
+      void
+      ping_idle (std::size_t seconds) {ping_idle_ = seconds;}
+
+      // Close connections that have been idle for longer than max_idle
+      // seconds (only in reap()) or that have existed for longer than
+      // max_lifetime seconds (in reap() and when about to be returned to
+      // the caller). The value of 0 (default) means no limit.
+      //
+      // These values as well as the ping threshold should be set before
+      // the pool is used.
+      //
+      void
+      max_idle (std::size_t seconds) {max_idle_ = seconds;}
+
+      void
+      max_lifetime (std::size_t seconds) {max_lifetime_ = seconds;}
+
+      // Go over the idle connections closing those that are past the
+      // maximum idle time or lifetime and pinging the rest (if pinging is
+      // enabled). Connections are taken out of the pool and checked one
+      // at a time so that the others remain available. Then create new
+      // connections if the pool went below the minimum. Return the number
+      // of connections closed. This function is meant to be called
+      // periodically, for example, from a background thread.
+      //
+      std::size_t
+      reap ();
+
+      // Parallel warm-up. If the number of threads is not 0, then instead
+      // of establishing the min_connections connections one after another
+      // in database(), the pool starts that many threads that establish
+      // them concurrently. Until the warm-up is complete, connect() falls
+      // back to creating connections on demand. If a connection cannot be
+      // established, the warm-up stops and the pool fills up lazily. The
+      // optional callback is called from the last warm-up thread with the
+      // outcome. This function should be called before the pool is passed
+      // to the database. Without thread support the connections are
+      // established serially.
+      //
+      typedef void (*warmup_callback) (connection_pool_factory&,
+                                       bool success,
+                                       void* arg);
+
+      void
+      warmup (std::size_t threads,
+              warmup_callback callback = 0,
+              void* arg = 0)
+      {
+        warmup_threads_ = threads;
+        warmup_callback_ = callback;
+        warmup_arg_ = arg;
+      }
+
+      // Return true if the warm-up is complete.
+      //
+      bool
+      ready ();
+
+      // Wait for the warm-up to complete. Return true if all the minimum
+      // connections have been established and false if the warm-up has
+      // stopped because of an error.
+      //
+      bool
+      wait_ready ();
+
       virtual connection_ptr
       connect ();
 
@@ -91,6 +179,10 @@ namespace odb
       public:
         pooled_connection (connection_pool_factory&);
         pooled_connection (connection_pool_factory&, MYSQL*);
+        pooled_connection (connection_pool_factory&,
+                           const char* host,
+                           unsigned int port,
+                           const char* socket);
 
       private:
         static bool
@@ -100,6 +192,10 @@ namespace odb
         friend class connection_pool_factory;
 
         shared_base::refcount_callback cb_;
+        std::size_t shard_; // Shard to return this connection to.
+
+        std::time_t created_; // Time this connection was established.
+        std::time_t used_;    // Time this connection was last released.
       };
 
       friend class pooled_connection;
@@ -113,24 +209,227 @@ namespace odb
       virtual pooled_connection_ptr
       create ();
 
+      // Stop the warm-up and wait for the warm-up threads to finish. Since
+      // these threads call create(), a derived factory that overrides it
+      // should call this function in its destructor, before the state used
+      // by its create() is destroyed.
+      //
+      void
+      stop_warmup ();
+
     protected:
       // Return true if the connection should be deleted, false otherwise.
       //
       bool
       release (pooled_connection*);
 
+    private:
+      struct shards_lock;
+      friend struct shards_lock;
+
+      // Return idle connections to the pool. Should be called with the
+      // pool mutex and all the shard mutexes locked.
+      //
+      void
+      put_ (connections&);
+
+      static void*
+      warmup_thread (void*);
+
+      void
+      warmup_ ();
+
     protected:
       const std::size_t max_;
       const std::size_t min_;
       const bool ping_;
 
-      std::size_t in_use_;  // Number of connections currently in use.
+      std::size_t ping_idle_;
+      std::size_t max_idle_;
+      std::size_t max_lifetime_;
+
+      // Warm-up state. Except for the settings, protected by the pool
+      // mutex.
+      //
+      std::size_t warmup_threads_;
+      warmup_callback warmup_callback_;
+      void* warmup_arg_;
+      std::size_t warmup_active_; // Number of running warm-up threads.
+      bool warmup_failed_;
+      bool warmup_stop_;
+      std::vector<details::thread*> warmup_list_;
+
+      // Idle connections are kept in several shards, each protected by
+      // its own mutex, so that threads checking connections out and in
+      // do not contend on a single lock. A thread first tries the shard
+      // selected based on its identity and then the others. The pool
+      // mutex and condition are only used when a connection has to be
+      // created or deleted and when the pool is exhausted and threads
+      // have to wait.
+      //
+      static const std::size_t shard_count = 8;
+
+      struct shard
+      {
+        details::mutex mutex;
+        connections idle;
+      };
+
+      shard shards_[shard_count];
+
+      // The connection count and the number of waiters are modified with
+      // the pool mutex and all the shard mutexes locked. As a result,
+      // they can be read with either the pool mutex or any of the shard
+      // mutexes locked.
+      //
+      std::size_t count_;   // Number of connections (idle and in use).
       std::size_t waiters_; // Number of threads waiting for a connection.
 
+      // Connections released while there are waiters. Protected by the
+      // pool mutex.
+      //
       connections connections_;
 
       details::mutex mutex_;
       details::condition cond_;
+      details::condition ready_cond_; // Warm-up completion.
+    };
+
+    // Connection pool for a replica server (see routing_connection_factory).
+    // The connections are established to the specified host, port, and
+    // socket instead of those of the database. The rest of the connection
+    // parameters (user, password, database name, character set, and
+    // client flags) are still taken from the database.
+    //
+    class LIBODB_MYSQL_EXPORT replica_pool_factory:
+      public connection_pool_factory
+    {
+    public:
+      replica_pool_factory (const std::string& host,
+                            unsigned int port = 0,
+                            const std::string& socket = "",
+                            std::size_t max_connections = 0,
+                            std::size_t min_connections = 0,
+                            bool ping = true)
+          : connection_pool_factory (max_connections, min_connections, ping),
+            host_ (host),
+            port_ (port),
+            socket_ (socket)
+      {
+      }
+
+      const std::string&
+      host () const
+      {
+        return host_;
+      }
+
+      unsigned int
+      port () const
+      {
+        return port_;
+      }
+
+      const std::string&
+      socket () const
+      {
+        return socket_;
+      }
+
+      virtual
+      ~replica_pool_factory ();
+
+    protected:
+      virtual pooled_connection_ptr
+      create ();
+
+    private:
+      std::string host_;
+      unsigned int port_;
+      std::string socket_;
+    };
+
+    // Read/write splitting for a primary and replicas setup. Connections
+    // for read-only transactions (see transaction_options::read_only)
+    // come from one of the replica factories, selected round-robin. All
+    // the other connections come from the primary factory. For example:
+    //
+    // routing_connection_factory* f (
+    //   new routing_connection_factory (new connection_pool_factory (20)));
+    //
+    // f->replica (new replica_pool_factory ("replica1", 3306, "", 20));
+    // f->replica (new replica_pool_factory ("replica2", 3306, "", 20));
+    //
+    // database db ("user", "secret", "db", "primary", 3306, 0, 0, 0, f);
+    //
+    // transaction_options o;
+    // o.read_only = true;
+    //
+    // transaction t (db.begin (o)); // Runs on one of the replicas.
+    //
+    // If a replica fails to provide a connection, then it is marked as
+    // down and skipped for the specified number of seconds, after which
+    // it is tried again. If all the replicas are down, then the primary
+    // is used. The factory takes ownership of the primary and replica
+    // factories. The replicas should be added before the factory is
+    // passed to the database.
+    //
+    class LIBODB_MYSQL_EXPORT routing_connection_factory:
+      public connection_factory
+    {
+    public:
+      routing_connection_factory (
+        details::transfer_ptr<connection_factory> primary,
+        std::size_t retry_seconds = 30);
+
+      void
+      replica (details::transfer_ptr<connection_factory>);
+
+      std::size_t
+      replica_count () const
+      {
+        return replicas_.size ();
+      }
+
+      // Return true if the replica is not marked as down.
+      //
+      bool
+      replica_healthy (std::size_t);
+
+      virtual connection_ptr
+      connect ();
+
+      virtual connection_ptr
+      connect_read_only ();
+
+      virtual void
+      database (database_type&);
+
+      virtual
+      ~routing_connection_factory ();
+
+    private:
+      routing_connection_factory (const routing_connection_factory&);
+      routing_connection_factory& operator= (
+        const routing_connection_factory&);
+
+    private:
+      struct replica_info
+      {
+        connection_factory* factory;
+        std::time_t down_until; // 0 if healthy.
+      };
+
+      typedef std::vector<replica_info> replicas;
+
+      connection_factory* primary_;
+      replicas replicas_;
+      const std::size_t retry_;
+
+      // Protects the health state and the next replica index.
+      //
+      std::size_t next_;
+      details::mutex mutex_;
     };
   }
 }
@@ -1,8 +1,11 @@
 // file      : odb/mysql/connection.cxx
 // license   : GNU GPL v2; see accompanying LICENSE file
 
-#include <new>    // std::bad_alloc
+#include <new>     // std::bad_alloc
 #include <string>
+#include <utility> // std::make_pair
+#include <cstdlib> // std::strtoul
+#include <cstring> // std::strlen, std::strstr
 
 #include <odb/mysql/database.hxx>
 #include <odb/mysql/connection.hxx>
@@ -20,7 +23,79 @@ namespace odb
   {
     connection::
     connection (connection_factory& cf)
-        : odb::connection (cf), failed_ (false), active_ (0)
+        : odb::connection (cf),
+          failed_ (false),
+          active_ (0),
+          cursor_prefetch_ (0),
+          lazy_begin_ (false),
+          isolation_ (transaction_options::isolation_default),
+          auto_increment_increment_ (0),
+          max_prepared_ (0),
+          prepared_count_ (0),
+          prepared_head_ (0),
+          prepared_tail_ (0),
+          max_idle_stmts_ (0),
+          idle_seq_ (0)
+    {
+      prepared_stats_.hits = 0;
+      prepared_stats_.misses = 0;
+      prepared_stats_.evictions = 0;
+
+      database_type& db (database ());
+      connect (db.host (), db.port (), db.socket ());
+    }
+
+    connection::
+    connection (connection_factory& cf, MYSQL* handle)
+        : odb::connection (cf),
+          failed_ (false),
+          handle_ (handle),
+          active_ (0),
+          cursor_prefetch_ (0),
+          lazy_begin_ (false),
+          isolation_ (transaction_options::isolation_default),
+          auto_increment_increment_ (0),
+          max_prepared_ (0),
+          prepared_count_ (0),
+          prepared_head_ (0),
+          prepared_tail_ (0),
+          max_idle_stmts_ (0),
+          idle_seq_ (0),
+          statement_cache_ (new statement_cache_type (*this))
+    {
+      prepared_stats_.hits = 0;
+      prepared_stats_.misses = 0;
+      prepared_stats_.evictions = 0;
+    }
+
+    connection::
+    connection (connection_factory& cf,
+                const char* host,
+                unsigned int port,
+                const char* socket)
+        : odb::connection (cf),
+          failed_ (false),
+          active_ (0),
+          cursor_prefetch_ (0),
+          lazy_begin_ (false),
+          isolation_ (transaction_options::isolation_default),
+          auto_increment_increment_ (0),
+          max_prepared_ (0),
+          prepared_count_ (0),
+          prepared_head_ (0),
+          prepared_tail_ (0),
+          max_idle_stmts_ (0),
+          idle_seq_ (0)
+    {
+      prepared_stats_.hits = 0;
+      prepared_stats_.misses = 0;
+      prepared_stats_.evictions = 0;
+
+      connect (host, port, socket);
+    }
+
+    void connection::
+    connect (const char* host, unsigned int port, const char* socket)
     {
       if (mysql_init (&mysql_) == 0)
         throw bad_alloc ();
@@ -40,12 +115,12 @@ namespace odb
       // and nothing-changed conditions.
       //
       if (mysql_real_connect (handle_,
-                              db.host (),
+                              host,
                               db.user (),
                               db.password (),
                               db.db (),
-                              db.port (),
-                              db.socket (),
+                              port,
+                              socket,
                               db.client_flags () | CLIENT_FOUND_ROWS) == 0)
       {
         // We cannot use translate_error() here since there is no connection
@@ -65,16 +140,6 @@ namespace odb
       statement_cache_.reset (new statement_cache_type (*this));
     }
 
-    connection::
-    connection (connection_factory& cf, MYSQL* handle)
-        : odb::connection (cf),
-          failed_ (false),
-          handle_ (handle),
-          active_ (0),
-          statement_cache_ (new statement_cache_type (*this))
-    {
-    }
-
     connection::
     ~connection ()
     {
@@ -85,6 +150,11 @@ namespace odb
       recycle ();
       clear_prepared_map ();
 
+      // Don't cache the handles of the statements that are about to be
+      // destroyed with the statement cache.
+      //
+      query_statement_cache (0);
+
       if (stmt_handles_.size () > 0)
         free_stmt_handles ();
     }
@@ -95,11 +165,35 @@ namespace odb
       return new transaction_impl (connection_ptr (inc_ref (this)));
     }
 
+    transaction_impl* connection::
+    begin (const transaction_options& o)
+    {
+      return new transaction_impl (connection_ptr (inc_ref (this)), o);
+    }
+
+    // Return true if the statement may change a session variable.
+    //
+    static bool
+    set_statement (const char* s, size_t n)
+    {
+      size_t i (0);
+      for (; i != n && (s[i] == ' ' || s[i] == '\t' || s[i] == '\n' ||
+                        s[i] == '\r'); ++i) ;
+
+      return n - i >= 3 &&
+        (s[i] == 's' || s[i] == 'S') &&
+        (s[i + 1] == 'e' || s[i + 1] == 'E') &&
+        (s[i + 2] == 't' || s[i + 2] == 'T');
+    }
+
     unsigned long long connection::
     execute (const char* s, size_t n)
     {
       clear ();
 
+      if (set_statement (s, n))
+        auto_increment_increment_ = 0;
+
       {
         odb::tracer* t;
         if ((t = transaction_tracer ()) ||
@@ -135,6 +229,107 @@ namespace odb
       return r;
     }
 
+    namespace
+    {
+      // Turn the multi-statement support off when leaving execute_batch(),
+      // including on error.
+      //
+      struct multi_statements_guard
+      {
+        multi_statements_guard (connection& c): c_ (c) {}
+
+        ~multi_statements_guard ()
+        {
+          MYSQL* h (c_.handle ());
+
+          // On error we may still have results pending which would make
+          // the server option command fail.
+          //
+          while (mysql_next_result (h) == 0)
+          {
+            if (MYSQL_RES* rs = mysql_store_result (h))
+              mysql_free_result (rs);
+          }
+
+          // If we cannot turn it off, then make sure the connection is not
+          // reused.
+          //
+          if (mysql_set_server_option (h, MYSQL_OPTION_MULTI_STATEMENTS_OFF))
+            c_.mark_failed ();
+        }
+
+      private:
+        connection& c_;
+      };
+    }
+
+    size_t connection::
+    execute_batch (const char* s,
+                   size_t n,
+                   vector<unsigned long long>* a)
+    {
+      clear ();
+
+      // Any of the statements in the batch can be SET.
+      //
+      auto_increment_increment_ = 0;
+
+      if (mysql_set_server_option (handle_, MYSQL_OPTION_MULTI_STATEMENTS_ON))
+        translate_error (*this);
+
+      multi_statements_guard g (*this);
+
+      {
+        odb::tracer* t;
+        if ((t = transaction_tracer ()) ||
+            (t = tracer ()) ||
+            (t = database ().tracer ()))
+        {
+          string str (s, n);
+          t->execute (*this, str.c_str ());
+        }
+      }
+
+      if (mysql_real_query (handle_, s, static_cast<unsigned long> (n)))
+        translate_error (*this);
+
+      // Walk the results. Once a statement fails, the server does not
+      // execute the rest and mysql_next_result() returns the error.
+      //
+      size_t r (0);
+
+      for (;; ++r)
+      {
+        unsigned long long c (0);
+
+        if (mysql_field_count (handle_) == 0)
+          c = static_cast<unsigned long long> (mysql_affected_rows (handle_));
+        else
+        {
+          if (MYSQL_RES* rs = mysql_store_result (handle_))
+          {
+            c = static_cast<unsigned long long> (mysql_num_rows (rs));
+            mysql_free_result (rs);
+          }
+          else
+            translate_error (*this);
+        }
+
+        if (a != 0)
+          a->push_back (c);
+
+        int e (mysql_next_result (handle_));
+
+        if (e == -1)
+          break;
+
+        if (e > 0)
+          translate_error (*this);
+      }
+
+      return r + 1;
+    }
+
     bool connection::
     ping ()
     {
@@ -160,12 +355,138 @@ namespace odb
       }
     }
 
+    unsigned long long connection::
+    auto_increment_increment ()
+    {
+      if (auto_increment_increment_ != 0)
+        return auto_increment_increment_;
+
+      clear ();
+
+      const char s[] = "SELECT @@auto_increment_increment";
+
+      {
+        odb::tracer* t;
+        if ((t = transaction_tracer ()) ||
+            (t = tracer ()) ||
+            (t = database ().tracer ()))
+          t->execute (*this, s);
+      }
+
+      if (mysql_real_query (handle_, s, sizeof (s) - 1))
+        translate_error (*this);
+
+      MYSQL_RES* rs (mysql_store_result (handle_));
+
+      if (rs == 0)
+        translate_error (*this);
+
+      unsigned long long r (1);
+
+      if (MYSQL_ROW row = mysql_fetch_row (rs))
+      {
+        if (row[0] != 0)
+          r = strtoul (row[0], 0, 10);
+      }
+
+      mysql_free_result (rs);
+      return auto_increment_increment_ = (r != 0 ? r : 1);
+    }
+
     void connection::
     clear_ ()
     {
       active_->cancel (); // Should clear itself from active_.
     }
 
+    void connection::
+    reset_session ()
+    {
+      cursor_prefetch_ = 0;
+      lazy_begin_ = false;
+      auto_increment_increment_ = 0;
+
+      if (failed ())
+        return;
+
+      // The current transaction and autocommit states are reported by the
+      // server with each response so we don't need to query them.
+      //
+      unsigned int s (handle ()->server_status);
+
+      if ((s & SERVER_STATUS_IN_TRANS) != 0 && mysql_rollback (handle_))
+      {
+        mark_failed ();
+        return;
+      }
+
+      if ((s & SERVER_STATUS_AUTOCOMMIT) == 0 && mysql_autocommit (handle_, 1))
+      {
+        mark_failed ();
+        return;
+      }
+
+      try
+      {
+        isolation (transaction_options::isolation_default);
+      }
+      catch (...)
+      {
+        mark_failed ();
+      }
+    }
+
+    void connection::
+    isolation (transaction_options::isolation_type i)
+    {
+      if (i == isolation_)
+        return;
+
+      const char* s (0);
+      switch (i)
+      {
+      case transaction_options::read_uncommitted:
+        s = "SET SESSION TRANSACTION ISOLATION LEVEL READ UNCOMMITTED";
+        break;
+      case transaction_options::read_committed:
+        s = "SET SESSION TRANSACTION ISOLATION LEVEL READ COMMITTED";
+        break;
+      case transaction_options::repeatable_read:
+        s = "SET SESSION TRANSACTION ISOLATION LEVEL REPEATABLE READ";
+        break;
+      case transaction_options::serializable:
+        s = "SET SESSION TRANSACTION ISOLATION LEVEL SERIALIZABLE";
+        break;
+      case transaction_options::isolation_default:
+        {
+          // Restore the global level. The variable was renamed in MySQL
+          // 5.7.20 (and the old name removed in 8.0) while MariaDB still
+          // uses the old name.
+          //
+          s = mysql_get_server_version (handle_) >= 50720 &&
+            strstr (mysql_get_server_info (handle_), "MariaDB") == 0
+            ? "SET SESSION transaction_isolation=DEFAULT"
+            : "SET SESSION tx_isolation=DEFAULT";
+          break;
+        }
+      }
+
+      {
+        odb::tracer* t;
+        if ((t = transaction_tracer ()) ||
+            (t = tracer ()) ||
+            (t = database ().tracer ()))
+          t->execute (*this, s);
+      }
+
+      if (mysql_real_query (handle_,
+                            s,
+                            static_cast<unsigned long> (strlen (s))))
+        translate_error (*this);
+
+      isolation_ = i;
+    }
+
     MYSQL_STMT* connection::
     alloc_stmt_handle ()
     {
@@ -189,6 +510,219 @@ namespace odb
       }
     }
 
+    void connection::
+    statement_prepared (statement& s, bool reused)
+    {
+      s.prepared_prev_ = 0;
+      s.prepared_next_ = prepared_head_;
+
+      if (prepared_head_ != 0)
+        prepared_head_->prepared_prev_ = &s;
+      else
+        prepared_tail_ = &s;
+
+      prepared_head_ = &s;
+      prepared_count_++;
+
+      if (reused)
+        prepared_stats_.hits++;
+      else
+        prepared_stats_.misses++;
+
+      if (max_prepared_ != 0 &&
+          prepared_count_ + idle_stmts_.size () > max_prepared_)
+      {
+        // Failing to evict only means we stay over the limit for now.
+        //
+        try
+        {
+          evict (s);
+        }
+        catch (const bad_alloc&)
+        {
+        }
+      }
+    }
+
+    void connection::
+    statement_used (statement& s)
+    {
+      prepared_stats_.hits++;
+
+      if (prepared_head_ != &s)
+      {
+        unlink (s);
+
+        s.prepared_prev_ = 0;
+        s.prepared_next_ = prepared_head_;
+        prepared_head_->prepared_prev_ = &s;
+        prepared_head_ = &s;
+        prepared_count_++;
+      }
+    }
+
+    void connection::
+    statement_released (statement& s)
+    {
+      unlink (s);
+    }
+
+    void connection::
+    unlink (statement& s)
+    {
+      if (s.prepared_prev_ != 0)
+        s.prepared_prev_->prepared_next_ = s.prepared_next_;
+      else
+        prepared_head_ = s.prepared_next_;
+
+      if (s.prepared_next_ != 0)
+        s.prepared_next_->prepared_prev_ = s.prepared_prev_;
+      else
+        prepared_tail_ = s.prepared_prev_;
+
+      s.prepared_prev_ = s.prepared_next_ = 0;
+      prepared_count_--;
+    }
+
+    void connection::
+    evict (statement& current)
+    {
+      // Idle handles go first.
+      //
+      while (!idle_stmts_.empty () &&
+             prepared_count_ + idle_stmts_.size () > max_prepared_)
+      {
+        close_idle_stmt ();
+        prepared_stats_.evictions++;
+      }
+
+      // Then walk from the least recently used end skipping the
+      // statements that cannot be released right now.
+      //
+      for (statement* s (prepared_tail_);
+           s != 0 && prepared_count_ > max_prepared_;)
+      {
+        statement* p (s->prepared_prev_);
+
+        if (s != &current && s->release ())
+          prepared_stats_.evictions++;
+
+        s = p;
+      }
+    }
+
+    void connection::
+    add_long_data (const void* b, long_data_source& s)
+    {
+      // The image may be initialized several times before the statement
+      // is executed.
+      //
+      for (long_data_sources::iterator i (long_data_.begin ());
+           i != long_data_.end (); ++i)
+      {
+        if (i->first == b)
+        {
+          i->second = &s;
+          return;
+        }
+      }
+
+      long_data_.push_back (make_pair (b, &s));
+    }
+
+    long_data_source* connection::
+    take_long_data (const void* b)
+    {
+      for (long_data_sources::iterator i (long_data_.begin ());
+           i != long_data_.end (); ++i)
+      {
+        if (i->first == b)
+        {
+          long_data_source* r (i->second);
+          long_data_.erase (i);
+          return r;
+        }
+      }
+
+      return 0;
+    }
+
+    void connection::
+    query_statement_cache (size_t n)
+    {
+      max_idle_stmts_ = n;
+
+      while (idle_stmts_.size () > max_idle_stmts_)
+        close_idle_stmt ();
+    }
+
+    MYSQL_STMT* connection::
+    cached_stmt_handle (const char* text, size_t size)
+    {
+      if (idle_stmts_.empty ())
+        return 0;
+
+      idle_stmts::iterator i (idle_stmts_.find (string (text, size)));
+
+      if (i == idle_stmts_.end ())
+        return 0;
+
+      MYSQL_STMT* r (i->second.first);
+      idle_order_.erase (i->second.second);
+      idle_stmts_.erase (i);
+      return r;
+    }
+
+    bool connection::
+    cache_stmt_handle (statement& s)
+    {
+      if (max_idle_stmts_ == 0)
+        return false;
+
+      if (idle_stmts_.size () == max_idle_stmts_)
+        close_idle_stmt ();
+
+      unsigned long long seq (idle_seq_++);
+
+      idle_stmts::iterator i (
+        idle_stmts_.insert (
+          idle_stmts::value_type (s.text_,
+                                  make_pair (s.stmt_.get (), seq))));
+
+      try
+      {
+        idle_order_.insert (idle_order::value_type (seq, i));
+      }
+      catch (...)
+      {
+        idle_stmts_.erase (i);
+        throw;
+      }
+
+      unlink (s);
+      s.stmt_.release ();
+      return true;
+    }
+
+    void connection::
+    close_idle_stmt ()
+    {
+      idle_order::iterator i (idle_order_.begin ());
+      close_stmt_handle (i->second->second.first); // May throw.
+
+      idle_stmts_.erase (i->second);
+      idle_order_.erase (i);
+    }
+
+    void connection::
+    close_stmt_handle (MYSQL_STMT* h)
+    {
+      if (active_ == 0)
+        mysql_stmt_close (h);
+      else
+        stmt_handles_.push_back (h); // May throw.
+    }
+
     void connection::
     free_stmt_handles ()
     {
@@ -208,6 +742,12 @@ namespace odb
     {
     }
 
+    connection_ptr connection_factory::
+    connect_read_only ()
+    {
+      return connect ();
+    }
+
     void connection_factory::
     database (database_type& db)
     {
@@ -6,7 +6,12 @@
 
 #include <odb/pre.hxx>
 
+#include <map>
+#include <string>
 #include <vector>
+#include <utility> // std::pair
+#include <cstring> // std::strlen
+#include <cstddef> // std::size_t
 
 #include <odb/connection.hxx>
 
@@ -29,6 +34,7 @@ namespace odb
   {
     class statement_cache;
     class connection_factory;
+    class long_data_source;
 
     class connection;
     typedef details::shared_ptr<connection> connection_ptr;
@@ -45,6 +51,16 @@ namespace odb
       connection (connection_factory&);
       connection (connection_factory&, MYSQL* handle);
 
+      // Connect to the specified server instead of the one specified in
+      // the database (for example, to a replica). The rest of the
+      // connection parameters are taken from the database. A NULL host or
+      // socket and 0 port mean the defaults.
+      //
+      connection (connection_factory&,
+                  const char* host,
+                  unsigned int port,
+                  const char* socket);
+
       database_type&
       database ();
 
@@ -52,12 +68,40 @@ namespace odb
       virtual transaction_impl*
       begin ();
 
+      transaction_impl*
+      begin (const transaction_options&);
+
     public:
       using odb::connection::execute;
 
       virtual unsigned long long
       execute (const char* statement, std::size_t length);
 
+      // Execute several semicolon-separated statements as a single query.
+      // Multi-statement support is only enabled on the connection for the
+      // duration of the call (which costs two extra round trips) so that
+      // queries executed in other ways still cannot contain several
+      // statements (for example, as a result of SQL injection). Return
+      // the number of statements executed and, if the second argument is
+      // not NULL, add the affected row count (or the number of rows in
+      // the result set) for each statement to the vector. If a statement
+      // fails, the server does not execute the remaining ones and the
+      // error is translated to an exception. In this case the vector
+      // contains the counts for the statements that have succeeded.
+      //
+      std::size_t
+      execute_batch (const char* statements,
+                     std::vector<unsigned long long>* affected = 0);
+
+      std::size_t
+      execute_batch (const std::string& statements,
+                     std::vector<unsigned long long>* affected = 0);
+
+      std::size_t
+      execute_batch (const char* statements,
+                     std::size_t length,
+                     std::vector<unsigned long long>* affected = 0);
+
       // Query preparation.
       //
     public:
@@ -116,6 +160,140 @@ namespace odb
       bool
       ping ();
 
+      // Return the value of the auto_increment_increment session variable.
+      // The value is queried once and then cached until the session is
+      // reset (see reset_session()) or a SET statement is executed with
+      // execute() or execute_batch().
+      //
+      unsigned long long
+      auto_increment_increment ();
+
+      // Server-side cursor mode. If the number of rows to prefetch is
+      // not 0, then query SELECT statements executed on this connection
+      // open a read-only cursor on the server and fetch the result in
+      // chunks of this many rows. Such a result does not hold up the
+      // connection (does not become active) so other statements can be
+      // executed while it is being iterated over. A cached result (the
+      // default for database::query()) is still stored on the client in
+      // its entirety and its size is known. To iterate over a large result
+      // with bounded client memory, request an uncached result in which
+      // case the rows are kept in windows of this many rows. The
+      // statements that load objects, containers, and sections (those
+      // with static text) never use a cursor. Since the mode only affects
+      // statement execution, it can be reset as soon as the query call
+      // returns. Note also that the server materializes the cursor result
+      // in a temporary table. The mode is reset when the connection is
+      // returned to the pool (see reset_session()).
+      //
+      void
+      cursor_prefetch (std::size_t n)
+      {
+        cursor_prefetch_ = n;
+      }
+
+      std::size_t
+      cursor_prefetch () const
+      {
+        return cursor_prefetch_;
+      }
+
+      // Lazy transaction begin mode. If true, then instead of sending
+      // BEGIN when a transaction is started, autocommit is turned off for
+      // the session (once) so that the server starts a transaction
+      // implicitly with the first statement. If no statement has been
+      // executed in the transaction, then COMMIT or ROLLBACK is not sent
+      // either. Note that COMMIT is still a separate round trip: the
+      // prepared statement protocol cannot carry it together with the
+      // last statement. Note also that in this mode the statements
+      // executed outside of a transaction start one implicitly. As with
+      // BEGIN in the normal mode, it is committed (which costs an extra
+      // round trip) when the next transaction is started. Autocommit is
+      // turned back on when a transaction is started after the mode has
+      // been switched off. The mode is also switched off when the
+      // connection is returned to the pool (see reset_session()).
+      //
+      void
+      lazy_begin (bool v)
+      {
+        lazy_begin_ = v;
+      }
+
+      bool
+      lazy_begin () const
+      {
+        return lazy_begin_;
+      }
+
+      // Prepared statement limit. If not 0, then the connection keeps at
+      // most this many statements prepared on the server (see also the
+      // server's max_prepared_stmt_count variable). When a statement is
+      // prepared and the limit is exceeded, the least recently executed
+      // statements are released. A released statement is transparently
+      // re-prepared the next time it is executed. Statements with a
+      // pending result are never released so the limit can be exceeded
+      // temporarily.
+      //
+      void
+      max_prepared_statements (std::size_t n)
+      {
+        max_prepared_ = n;
+      }
+
+      std::size_t
+      max_prepared_statements () const
+      {
+        return max_prepared_;
+      }
+
+      // Number of statements currently prepared on the server, including
+      // the idle ones in the query statement cache.
+      //
+      std::size_t
+      prepared_statements () const
+      {
+        return prepared_count_ + idle_stmts_.size ();
+      }
+
+      struct prepared_statistics_type
+      {
+        // Executions of a statement that was already prepared.
+        //
+        unsigned long long hits;
+
+        // Statement preparations, including re-preparations of released
+        // statements.
+        //
+        unsigned long long misses;
+
+        // Statements released to stay within the limit.
+        //
+        unsigned long long evictions;
+      };
+
+      const prepared_statistics_type&
+      prepared_statistics () const
+      {
+        return prepared_stats_;
+      }
+
+      // Query statement cache. If n is not 0, then instead of being
+      // closed, the handles of destroyed SELECT statements (for example,
+      // the ones created for each database::query() call) are kept
+      // prepared, up to n, and reused by the next SELECT statement with
+      // the same text. The new statement only has to bind its parameters
+      // and results. When the cache is full, the least recently cached
+      // handle is closed. Setting the size to 0 closes all the cached
+      // handles.
+      //
+      void
+      query_statement_cache (std::size_t n);
+
+      std::size_t
+      query_statement_cache () const
+      {
+        return max_idle_stmts_;
+      }
+
     public:
       MYSQL*
       handle ()
@@ -154,6 +332,19 @@ namespace odb
           clear_ ();
       }
 
+      // Restore the per-session modes (cursor_prefetch(), lazy_begin())
+      // to their defaults before the connection is reused by someone else
+      // (for example, when it is returned to the pool). This also rolls
+      // back the transaction that the statements executed outside of a
+      // transaction in the lazy begin mode may have started, turns
+      // autocommit back on, and restores the default isolation level if
+      // it was changed (see transaction_options). If the session state
+      // cannot be restored, then the connection is marked as failed.
+      // Does not throw.
+      //
+      void
+      reset_session ();
+
     public:
       MYSQL_STMT*
       alloc_stmt_handle ();
@@ -161,19 +352,91 @@ namespace odb
       void
       free_stmt_handle (auto_handle<MYSQL_STMT>&);
 
+      // Prepared statement list maintained by the statements, most
+      // recently executed first.
+      //
+      void
+      statement_prepared (statement&, bool reused = false);
+
+      void
+      statement_used (statement&);
+
+      void
+      statement_released (statement&);
+
+      // Streamed long data (see long_data). The source is registered for
+      // the parameter image buffer when the image is initialized and is
+      // taken by the statement that binds this buffer. The remaining
+      // registrations are discarded at the end of the transaction.
+      //
+      void
+      add_long_data (const void* buffer, long_data_source&);
+
+      bool
+      long_data_pending () const
+      {
+        return !long_data_.empty ();
+      }
+
+      // Return NULL if there is no source for this buffer.
+      //
+      long_data_source*
+      take_long_data (const void* buffer);
+
+      void
+      clear_long_data ()
+      {
+        long_data_.clear ();
+      }
+
+      // Return a cached handle for the statement text or NULL if there
+      // is none.
+      //
+      MYSQL_STMT*
+      cached_stmt_handle (const char* text, std::size_t size);
+
+      // Move the statement handle to the query statement cache. Return
+      // false if the cache is disabled.
+      //
+      bool
+      cache_stmt_handle (statement&);
+
     private:
       connection (const connection&);
       connection& operator= (const connection&);
 
     private:
+      // Establish the connection (called from the constructors).
+      //
+      void
+      connect (const char* host, unsigned int port, const char* socket);
+
       void
       free_stmt_handles ();
 
+      void
+      unlink (statement&);
+
+      void
+      evict (statement& current);
+
+      void
+      close_stmt_handle (MYSQL_STMT*);
+
+      void
+      close_idle_stmt ();
+
       void
       clear_ ();
 
+      // Change the session isolation level if it differs from the
+      // current one.
+      //
+      void
+      isolation (transaction_options::isolation_type);
+
     private:
-      friend class transaction_impl; // invalidate_results()
+      friend class transaction_impl; // invalidate_results(), isolation()
 
     private:
       bool failed_;
@@ -183,6 +446,46 @@ namespace odb
 
       statement* active_;
 
+      std::size_t cursor_prefetch_;
+      bool lazy_begin_;
+
+      // Session isolation level set with isolation(). The default value
+      // means the server's default level is in effect.
+      //
+      transaction_options::isolation_type isolation_;
+
+      // Cached auto_increment_increment value or 0 if unknown.
+      //
+      unsigned long long auto_increment_increment_;
+
+      // Keep the prepared statement list before statement_cache_ since
+      // the statements unlink themselves when destroyed.
+      //
+      std::size_t max_prepared_;
+      std::size_t prepared_count_;
+      statement* prepared_head_;
+      statement* prepared_tail_;
+      prepared_statistics_type prepared_stats_;
+
+      // Idle handles in the query statement cache. The sequence number
+      // orders them by the time they were cached.
+      //
+      typedef std::multimap<std::string,
+                            std::pair<MYSQL_STMT*, unsigned long long> >
+      idle_stmts;
+
+      typedef std::map<unsigned long long, idle_stmts::iterator> idle_order;
+
+      std::size_t max_idle_stmts_;
+      unsigned long long idle_seq_;
+      idle_stmts idle_stmts_;
+      idle_order idle_order_;
+
+      typedef std::vector<std::pair<const void*, long_data_source*> >
+      long_data_sources;
+
+      long_data_sources long_data_;
+
       // Keep statement_cache_ after handle_ so that it is destroyed before
       // the connection is closed.
       //
@@ -210,6 +513,13 @@ namespace odb
       virtual connection_ptr
       connect () = 0;
 
+      // Return a connection for a read-only transaction (see
+      // transaction_options::read_only). By default the same as
+      // connect().
+      //
+      virtual connection_ptr
+      connect_read_only ();
+
       virtual
       ~connection_factory ();
 
@@ -11,6 +11,18 @@ namespace odb
       return static_cast<connection_factory&> (factory_).database ();
     }
 
+    inline std::size_t connection::
+    execute_batch (const char* s, std::vector<unsigned long long>* a)
+    {
+      return execute_batch (s, std::strlen (s), a);
+    }
+
+    inline std::size_t connection::
+    execute_batch (const std::string& s, std::vector<unsigned long long>* a)
+    {
+      return execute_batch (s.c_str (), s.size (), a);
+    }
+
     template <typename T>
     inline prepared_query<T> connection::
     prepare_query (const char* n, const char* q)
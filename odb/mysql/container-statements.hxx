@@ -145,7 +145,8 @@ namespace odb
               false,        // Don't optimize.
               id_binding_,
               select_image_binding_,
-              false));
+              false,        // Don't copy text.
+              false));      // No cursor.
 
         return *select_;
       }
@@ -236,6 +236,18 @@ namespace odb
       return new transaction_impl (*this);
     }
 
+    connection_ptr database::
+    read_only_connection ()
+    {
+      return factory_->connect_read_only ();
+    }
+
+    transaction_impl* database::
+    begin (const transaction_options& o)
+    {
+      return new transaction_impl (*this, o);
+    }
+
     odb::connection* database::
     connection_ ()
     {
@@ -313,11 +325,12 @@ namespace odb
       {
         select_statement st (c,
                              text.c_str (),
-                             false, // Don't process.
-                             false, // Don't optimize.
+                             false,  // Don't process.
+                             false,  // Don't optimize.
                              param,
                              result,
-                             false);
+                             false,  // Don't copy text.
+                             false); // No cursor.
         st.execute ();
         auto_result ar (st);
 
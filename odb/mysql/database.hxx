@@ -214,6 +214,21 @@ namespace odb
       typename object_traits<T>::id_type
       persist (const typename object_traits<T>::pointer_type& obj_ptr);
 
+      // Bulk persist. Can be a range of references or pointers (including
+      // smart pointers) to objects. The objects are inserted in batches
+      // with a single multi-row INSERT statement per power-of-two chunk
+      // of the batch (see insert_statement::execute()).
+      //
+      // Note that the bulk operations require the bulk functions in the
+      // object traits which the ODB compiler currently does not generate
+      // for MySQL (the db bulk pragma is rejected for this database). As
+      // a result, they are only usable with hand-written traits (see
+      // tests/bulk for an example).
+      //
+      template <typename I>
+      void
+      persist (I begin, I end, bool continue_failed = true);
+
       // Load an object. Throw object_not_persistent if not found.
       //
       template <typename T>
@@ -300,6 +315,15 @@ namespace odb
       void
       update (const typename object_traits<T>::pointer_type& obj_ptr);
 
+      // Bulk update. Can be a range of references or pointers (including
+      // smart pointers) to objects. The objects are updated with a single
+      // UPDATE statement per power-of-two chunk of the batch. See also
+      // the note on bulk persist above.
+      //
+      template <typename I>
+      void
+      update (I begin, I end, bool continue_failed = true);
+
       // Update a section of an object. Throws the section_not_loaded
       // exception if the section is not loaded. Note also that this
       // function does not clear the changed flag if it is set.
@@ -343,6 +367,21 @@ namespace odb
       void
       erase (const typename object_traits<T>::pointer_type& obj_ptr);
 
+      // Bulk erase. The ids are deleted in batches with a single DELETE
+      // statement per power-of-two chunk of the batch. See also the note
+      // on bulk persist above.
+      //
+      template <typename T, typename I>
+      void
+      erase (I id_begin, I id_end, bool continue_failed = true);
+
+      // Can be a range of references or pointers (including smart pointers)
+      // to objects.
+      //
+      template <typename I>
+      void
+      erase (I obj_begin, I obj_end, bool continue_failed = true);
+
       // Erase multiple objects matching a query predicate.
       //
       template <typename T>
@@ -473,10 +512,22 @@ namespace odb
       virtual transaction_impl*
       begin ();
 
+      // Begin a transaction with the specified characteristics (see
+      // transaction_options).
+      //
+      transaction_impl*
+      begin (const transaction_options&);
+
     public:
       connection_ptr
       connection ();
 
+      // Return a connection for a read-only transaction (see
+      // connection_factory::connect_read_only()).
+      //
+      connection_ptr
+      read_only_connection ();
+
       // SQL statement tracing.
       //
     public:
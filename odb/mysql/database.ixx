@@ -121,6 +121,13 @@ namespace odb
       return persist_<T, id_mysql> (pobj);
     }
 
+    template <typename I>
+    inline void database::
+    persist (I b, I e, bool cont)
+    {
+      persist_<I, id_mysql> (b, e, cont);
+    }
+
     template <typename T>
     inline typename object_traits<T>::pointer_type database::
     load (const typename object_traits<T>::id_type& id)
@@ -282,6 +289,13 @@ namespace odb
       update_<T, id_mysql> (pobj);
     }
 
+    template <typename I>
+    inline void database::
+    update (I b, I e, bool cont)
+    {
+      update_<I, id_mysql> (b, e, cont);
+    }
+
     template <typename T>
     inline void database::
     update (const T& obj, const section& s)
@@ -371,6 +385,20 @@ namespace odb
       erase_<T, id_mysql> (pobj);
     }
 
+    template <typename T, typename I>
+    inline void database::
+    erase (I idb, I ide, bool cont)
+    {
+      erase_id_<I, T, id_mysql> (idb, ide, cont);
+    }
+
+    template <typename I>
+    inline void database::
+    erase (I ob, I oe, bool cont)
+    {
+      erase_object_<I, id_mysql> (ob, oe, cont);
+    }
+
     template <typename T>
     inline unsigned long long database::
     erase_query ()
@@ -25,6 +25,7 @@ namespace odb
     class connection_factory;
     class statement;
     class transaction;
+    class transaction_options;
     class tracer;
 
     namespace core
@@ -33,6 +34,7 @@ namespace odb
       using mysql::connection;
       using mysql::connection_ptr;
       using mysql::transaction;
+      using mysql::transaction_options;
       using mysql::statement;
     }
 
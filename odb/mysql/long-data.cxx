@@ -0,0 +1,49 @@
+// file      : odb/mysql/long-data.cxx
+// license   : GNU GPL v2; see accompanying LICENSE file
+
+#include <odb/mysql/connection.hxx>
+#include <odb/mysql/transaction.hxx>
+#include <odb/mysql/long-data.hxx>
+
+using namespace std;
+
+namespace odb
+{
+  namespace mysql
+  {
+    // long_data_source
+    //
+    long_data_source::
+    ~long_data_source ()
+    {
+    }
+
+    // long_data_value_traits
+    //
+    void long_data_value_traits::
+    set_image (details::buffer& b,
+               size_t& n,
+               bool& is_null,
+               const long_data& v)
+    {
+      n = 0;
+
+      if (v.source () == 0)
+      {
+        is_null = true;
+        return;
+      }
+
+      is_null = false;
+
+      // The buffer address identifies the parameter in the bind array so
+      // make sure it is allocated.
+      //
+      if (b.capacity () == 0)
+        b.capacity (1);
+
+      transaction::current ().connection ().add_long_data (
+        b.data (), *v.source ());
+    }
+  }
+}
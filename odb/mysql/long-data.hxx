@@ -0,0 +1,127 @@
+// file      : odb/mysql/long-data.hxx
+// license   : GNU GPL v2; see accompanying LICENSE file
+
+#ifndef ODB_MYSQL_LONG_DATA_HXX
+#define ODB_MYSQL_LONG_DATA_HXX
+
+#include <odb/pre.hxx>
+
+#include <cstddef> // std::size_t
+
+#include <odb/details/buffer.hxx>
+
+#include <odb/mysql/version.hxx>
+#include <odb/mysql/mysql-types.hxx>
+#include <odb/mysql/traits.hxx>
+
+#include <odb/mysql/details/export.hxx>
+
+namespace odb
+{
+  namespace mysql
+  {
+    // Source of the data for a streamed BLOB or TEXT parameter.
+    //
+    class LIBODB_MYSQL_EXPORT long_data_source
+    {
+    public:
+      virtual
+      ~long_data_source ();
+
+      // Read up to n bytes into the buffer and return the number of bytes
+      // read with 0 indicating the end of the data.
+      //
+      virtual std::size_t
+      read (char* buffer, std::size_t n) = 0;
+    };
+
+    // Streamed BLOB or TEXT value. When an object with a member of this
+    // type is persisted or updated, the data is read from the source and
+    // sent to the server in chunks (mysql_stmt_send_long_data()) instead
+    // of being copied into the image. This way the whole value is never
+    // in memory and is not limited by max_allowed_packet. For example:
+    //
+    // #pragma db value(odb::mysql::long_data) type("LONGBLOB")
+    //
+    // #pragma db object
+    // class attachment
+    // {
+    //   ...
+    //   odb::mysql::long_data data_;
+    // };
+    //
+    // The source is not owned and must remain valid until the statement
+    // is executed. It is read once per execution. An empty value (no
+    // source) is stored as NULL. This type can only be used to store the
+    // data; loading leaves the value empty.
+    //
+    class long_data
+    {
+    public:
+      long_data (): source_ (0) {}
+
+      explicit
+      long_data (long_data_source& s): source_ (&s) {}
+
+      long_data_source*
+      source () const
+      {
+        return source_;
+      }
+
+      void
+      source (long_data_source* s)
+      {
+        source_ = s;
+      }
+
+    private:
+      long_data_source* source_;
+    };
+
+    class LIBODB_MYSQL_EXPORT long_data_value_traits
+    {
+    public:
+      typedef long_data value_type;
+      typedef long_data query_type;
+      typedef details::buffer image_type;
+
+      static void
+      set_value (long_data& v, const details::buffer&, std::size_t, bool)
+      {
+        v.source (0);
+      }
+
+      // Register the source for streaming with the connection of the
+      // current transaction. The image itself stays empty.
+      //
+      static void
+      set_image (details::buffer&,
+                 std::size_t& n,
+                 bool& is_null,
+                 const long_data&);
+    };
+
+    template <>
+    struct LIBODB_MYSQL_EXPORT default_value_traits<long_data, id_blob>:
+      long_data_value_traits
+    {
+    };
+
+    template <>
+    struct LIBODB_MYSQL_EXPORT default_value_traits<long_data, id_string>:
+      long_data_value_traits
+    {
+    };
+
+    template <>
+    struct default_type_traits<long_data>
+    {
+      static const database_type_id db_type_id = id_blob;
+    };
+  }
+}
+
+#include <odb/post.hxx>
+
+#endif // ODB_MYSQL_LONG_DATA_HXX
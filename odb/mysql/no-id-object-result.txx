@@ -69,11 +69,13 @@ namespace odb
       // If we are cached, simply increment the position and
       // postpone the actual row fetching until later. This way
       // if the same object is loaded in between iteration, the
-      // image won't be messed up.
+      // image won't be messed up. If the result is read in
+      // windows, then we don't know the size so we have to fetch
+      // (the row can still be re-fetched from the window).
       //
       count_++;
 
-      if (statement_->cached ())
+      if (statement_->cached () && !statement_->windowed ())
         this->end_ = count_ > statement_->result_size ();
       else
         fetch ();
@@ -86,10 +88,10 @@ namespace odb
     void no_id_object_result_impl<T>::
     fetch ()
     {
-      // If the result is cached, the image can grow between calls
+      // If the result is refetchable, the image can grow between calls
       // to fetch() as a result of other statements execution.
       //
-      if (statement_->cached ())
+      if (statement_->refetchable ())
       {
         typename object_traits::image_type& im (statements_.image ());
 
@@ -151,7 +153,7 @@ namespace odb
       {
         statement_->cache ();
 
-        if (count_ == statement_->result_size ())
+        if (!statement_->windowed () && count_ == statement_->result_size ())
         {
           statement_->free_result ();
           count_++; // One past the result size.
@@ -166,7 +168,7 @@ namespace odb
     {
       if (!this->end_)
       {
-        if (!statement_->cached ())
+        if (!statement_->cached () || statement_->windowed ())
           throw result_not_cached ();
 
         return statement_->result_size ();
@@ -53,7 +53,7 @@ namespace odb
     {
       if (count_ > statement_->fetched ())
         fetch ();
-      else if (f && statement_->cached ())
+      else if (f && statement_->refetchable ())
       {
         // We have to re-load the image in case it has been overwritten
         // between the last time we fetched and this call to load().
@@ -172,7 +172,7 @@ namespace odb
     {
       if (count_ > statement_->fetched ())
         fetch ();
-      else if (statement_->cached ())
+      else if (statement_->refetchable ())
       {
         // We have to re-load the image in case it has been overwritten
         // between the last time we fetched and this call to load_id().
@@ -190,7 +190,7 @@ namespace odb
     {
       if (count_ > statement_->fetched ())
         fetch ();
-      else if (statement_->cached ())
+      else if (statement_->refetchable ())
       {
         // We have to re-load the image in case it has been overwritten
         // between the last time we fetched and this call to
@@ -215,11 +215,13 @@ namespace odb
       // If we are cached, simply increment the position and
       // postpone the actual row fetching until later. This way
       // if the same object is loaded in between iteration, the
-      // image won't be messed up.
+      // image won't be messed up. If the result is read in
+      // windows, then we don't know the size so we have to fetch
+      // (the row can still be re-fetched from the window).
       //
       count_++;
 
-      if (statement_->cached ())
+      if (statement_->cached () && !statement_->windowed ())
         this->end_ = count_ > statement_->result_size ();
       else
         fetch ();
@@ -288,10 +290,10 @@ namespace odb
     {
       typedef polymorphic_image_rebind<object_type, root_type> image_rebind;
 
-      // If the result is cached, the image can grow between calls
+      // If the result is refetchable, the image can grow between calls
       // to fetch() as a result of other statements execution.
       //
-      if (statement_->cached ())
+      if (statement_->refetchable ())
         image_rebind::rebind (statements_, tc_.version ());
 
       while (!this->end_ && (!next || count_ > statement_->fetched ()))
@@ -343,7 +345,7 @@ namespace odb
       {
         statement_->cache ();
 
-        if (count_ == statement_->result_size ())
+        if (!statement_->windowed () && count_ == statement_->result_size ())
         {
           statement_->free_result ();
           count_++; // One past the result size.
@@ -358,7 +360,7 @@ namespace odb
     {
       if (!this->end_)
       {
-        if (!statement_->cached ())
+        if (!statement_->cached () || statement_->windowed ())
           throw result_not_cached ();
 
         return statement_->result_size ();
@@ -103,11 +103,12 @@ namespace odb
             new (details::shared) select_statement_type (
               this->conn_,
               object_traits::find_discriminator_statement,
-              false, // Doesn't need to be processed.
-              false, // Don't optimize.
+              false,   // Doesn't need to be processed.
+              false,   // Don't optimize.
               discriminator_id_image_binding_,
               discriminator_image_binding_,
-              false));
+              false,   // Don't copy text.
+              false)); // No cursor.
 
         return *find_discriminator_;
       }
@@ -334,7 +335,8 @@ namespace odb
               false,                    // Don't optimize.
               root_statements_.id_image_binding (),
               select_image_bindings_[i],
-              false));
+              false,                    // Don't copy text.
+              false));                  // No cursor.
 
         return *p;
       }
@@ -1,7 +1,15 @@
 // file      : odb/mysql/query-dynamic.cxx
 // license   : GNU GPL v2; see accompanying LICENSE file
 
+#include <map>
+#include <list>
+#include <vector>
+#include <string>
+#include <utility> // std::pair
 #include <cstddef> // std::size_t
+#include <cstring> // std::memset
+
+#include <odb/details/tls.hxx>
 
 #include <odb/mysql/query-dynamic.hxx>
 
@@ -14,8 +22,14 @@ namespace odb
     static const char* logic_operators[] = {") AND (", ") OR ("};
     static const char* comp_operators[] = {"=", "!=", "<", ">", "<=", ">="};
 
+    // If params is not NULL, then add the index of each parameter part
+    // in the order they are appended.
+    //
     static void
-    translate (query_base& q, const odb::query_base& s, size_t p)
+    translate (query_base& q,
+               const odb::query_base& s,
+               size_t p,
+               vector<size_t>* params)
     {
       typedef odb::query_base::clause_part part;
 
@@ -48,6 +62,10 @@ namespace odb
 
           q.append (f (p->value, x.kind == part::kind_param_ref),
                     c->conversion ());
+
+          if (params != 0)
+            params->push_back (&x - &s.clause ()[0]);
+
           break;
         }
       case part::kind_native:
@@ -63,31 +81,31 @@ namespace odb
         }
       case part::op_add:
         {
-          translate (q, s, x.data);
-          translate (q, s, p - 1);
+          translate (q, s, x.data, params);
+          translate (q, s, p - 1, params);
           break;
         }
       case part::op_and:
       case part::op_or:
         {
           q += "(";
-          translate (q, s, x.data);
+          translate (q, s, x.data, params);
           q += logic_operators[x.kind - part::op_and];
-          translate (q, s, p - 1);
+          translate (q, s, p - 1, params);
           q += ")";
           break;
         }
       case part::op_not:
         {
           q += "NOT (";
-          translate (q, s, p - 1);
+          translate (q, s, p - 1, params);
           q += ")";
           break;
         }
       case part::op_null:
       case part::op_not_null:
         {
-          translate (q, s, p - 1);
+          translate (q, s, p - 1, params);
           q += (x.kind == part::op_null ? "IS NULL" : "IS NOT NULL");
           break;
         }
@@ -97,7 +115,7 @@ namespace odb
           {
             size_t b (p - x.data);
 
-            translate (q, s, b - 1); // column
+            translate (q, s, b - 1, params); // column
             q += "IN (";
 
             for (size_t i (b); i != p; ++i)
@@ -105,7 +123,7 @@ namespace odb
               if (i != b)
                 q += ",";
 
-              translate (q, s, i);
+              translate (q, s, i, params);
             }
 
             q += ")";
@@ -117,18 +135,18 @@ namespace odb
         }
       case part::op_like:
         {
-          translate (q, s, p - 2); // column
+          translate (q, s, p - 2, params); // column
           q += "LIKE";
-          translate (q, s, p - 1); // pattern
+          translate (q, s, p - 1, params); // pattern
           break;
         }
       case part::op_like_escape:
         {
-          translate (q, s, p - 3); // column
+          translate (q, s, p - 3, params); // column
           q += "LIKE";
-          translate (q, s, p - 2); // pattern
+          translate (q, s, p - 2, params); // pattern
           q += "ESCAPE";
-          translate (q, s, p - 1); // escape
+          translate (q, s, p - 1, params); // escape
           break;
         }
       case part::op_eq:
@@ -138,20 +156,320 @@ namespace odb
       case part::op_le:
       case part::op_ge:
         {
-          translate (q, s, x.data);
+          translate (q, s, x.data, params);
           q += comp_operators[x.kind - part::op_eq];
-          translate (q, s, p - 1);
+          translate (q, s, p - 1, params);
+          break;
+        }
+      }
+    }
+
+    // Translated query shapes. The shape of a dynamic query is its
+    // clause parts without the parameter values. For each shape we keep
+    // the translated clause and the source part for each parameter so
+    // that on the next translation of a query with the same shape we
+    // only need to extract the parameter values.
+    //
+    namespace
+    {
+      // Shape of a clause part. Columns are identified by their native
+      // column objects (static in the generated code) and native parts
+      // by their text.
+      //
+      struct shape_part
+      {
+        odb::query_base::clause_part::kind_type kind;
+        size_t data; // Operator data.
+        const void* column;
+        const void* factory;
+      };
+
+      struct query_shape
+      {
+        size_t hash;
+        vector<shape_part> parts;
+        vector<string> natives;
+
+        vector<query_base::clause_part> clause;
+        string text;
+        vector<size_t> params;
+      };
+
+      // Each thread keeps its own cache so that no locking is necessary.
+      // The most recently used shapes are at the front of the list and
+      // when the cache is full the least recently used one is evicted.
+      //
+      typedef list<query_shape> shape_list;
+      typedef multimap<size_t, shape_list::iterator> shape_map;
+
+      struct query_shape_cache
+      {
+        shape_list shapes;
+        shape_map map;
+      };
+
+      // Normally the number of distinct shapes in an application is small
+      // but, for example, IN with a variable number of values or native
+      // parts with literal values can produce many.
+      //
+      const size_t max_query_shapes = 256;
+
+      static ODB_TLS_OBJECT (query_shape_cache) query_shapes_;
+    }
+
+    static inline void
+    hash_combine (size_t& h, size_t v)
+    {
+      h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+
+    // Calculate the hash of the query shape.
+    //
+    static size_t
+    shape_hash (const odb::query_base& s)
+    {
+      typedef odb::query_base::clause_part part;
+
+      const odb::query_base::clause_type& c (s.clause ());
+      size_t h (c.size ());
+
+      for (odb::query_base::clause_type::const_iterator i (c.begin ()),
+             e (c.end ()); i != e; ++i)
+      {
+        const part& x (*i);
+        hash_combine (h, static_cast<size_t> (x.kind));
+
+        switch (x.kind)
+        {
+        case part::kind_column:
+        case part::kind_param_val:
+        case part::kind_param_ref:
+          {
+            // The parameter value is not part of the shape.
+            //
+            hash_combine (
+              h, reinterpret_cast<size_t> (x.native_info[id_mysql].column));
+            break;
+          }
+        case part::kind_native:
+          {
+            const string& n (s.strings ()[x.data]);
+
+            for (string::const_iterator j (n.begin ()); j != n.end (); ++j)
+              h = h * 31 + static_cast<unsigned char> (*j);
+
+            break;
+          }
+        case part::kind_true:
+        case part::kind_false:
+          break;
+        default:
+          {
+            hash_combine (h, x.data);
+            break;
+          }
+        }
+      }
+
+      return h;
+    }
+
+    static void
+    shape_init (query_shape& sh, const odb::query_base& s)
+    {
+      typedef odb::query_base::clause_part part;
+
+      const odb::query_base::clause_type& c (s.clause ());
+      sh.parts.resize (c.size ());
+
+      for (size_t i (0); i != c.size (); ++i)
+      {
+        const part& x (c[i]);
+        shape_part& y (sh.parts[i]);
+
+        y.kind = x.kind;
+        y.data = 0;
+        y.column = 0;
+        y.factory = 0;
+
+        switch (x.kind)
+        {
+        case part::kind_column:
+        case part::kind_param_val:
+        case part::kind_param_ref:
+          {
+            y.column = x.native_info[id_mysql].column;
+            y.factory = x.native_info[id_mysql].param_factory;
+            break;
+          }
+        case part::kind_native:
+          {
+            sh.natives.push_back (s.strings ()[x.data]);
+            break;
+          }
+        case part::kind_true:
+        case part::kind_false:
+          break;
+        default:
+          {
+            y.data = x.data;
+            break;
+          }
+        }
+      }
+    }
+
+    static bool
+    shape_match (const query_shape& sh, const odb::query_base& s)
+    {
+      typedef odb::query_base::clause_part part;
+
+      const odb::query_base::clause_type& c (s.clause ());
+
+      if (c.size () != sh.parts.size ())
+        return false;
+
+      size_t n (0); // Native part index.
+
+      for (size_t i (0); i != c.size (); ++i)
+      {
+        const part& x (c[i]);
+        const shape_part& y (sh.parts[i]);
+
+        if (x.kind != y.kind)
+          return false;
+
+        switch (x.kind)
+        {
+        case part::kind_column:
+        case part::kind_param_val:
+        case part::kind_param_ref:
+          {
+            if (x.native_info[id_mysql].column != y.column ||
+                x.native_info[id_mysql].param_factory != y.factory)
+              return false;
+
+            break;
+          }
+        case part::kind_native:
+          {
+            if (s.strings ()[x.data] != sh.natives[n++])
+              return false;
+
+            break;
+          }
+        case part::kind_true:
+        case part::kind_false:
           break;
+        default:
+          {
+            if (x.data != y.data)
+              return false;
+
+            break;
+          }
         }
       }
+
+      return true;
     }
 
     query_base::
     query_base (const odb::query_base& q)
         : binding_ (0, 0)
     {
-      if (!q.empty ())
-        translate (*this, q, q.clause ().size () - 1);
+      if (q.empty ())
+        return;
+
+      query_shape_cache& sc (tls_get (query_shapes_));
+
+      size_t h (shape_hash (q));
+      shape_list::iterator si (sc.shapes.end ());
+
+      for (pair<shape_map::iterator, shape_map::iterator> r (
+             sc.map.equal_range (h)); r.first != r.second; ++r.first)
+      {
+        if (shape_match (*r.first->second, q))
+        {
+          si = r.first->second;
+          break;
+        }
+      }
+
+      if (si == sc.shapes.end ())
+      {
+        query_shape sh;
+        translate (*this, q, q.clause ().size () - 1, &sh.params);
+
+        if (sc.shapes.size () == max_query_shapes)
+        {
+          // Evict the least recently used shape.
+          //
+          shape_list::iterator i (--sc.shapes.end ());
+
+          for (pair<shape_map::iterator, shape_map::iterator> r (
+                 sc.map.equal_range (i->hash)); r.first != r.second;
+               ++r.first)
+          {
+            if (r.first->second == i)
+            {
+              sc.map.erase (r.first);
+              break;
+            }
+          }
+
+          sc.shapes.erase (i);
+        }
+
+        sh.hash = h;
+        shape_init (sh, q);
+        sh.clause = clause_;
+        sh.text = text_;
+
+        sc.shapes.push_front (sh);
+        sc.map.insert (shape_map::value_type (h, sc.shapes.begin ()));
+        return;
+      }
+
+      // Move the shape to the front of the list.
+      //
+      sc.shapes.splice (sc.shapes.begin (), sc.shapes, si);
+
+      const query_shape& sh (*si);
+
+      clause_ = sh.clause;
+      text_ = sh.text;
+
+      size_t n (sh.params.size ());
+
+      if (n == 0)
+        return;
+
+      parameters_.reserve (n);
+      bind_.resize (n);
+      memset (&bind_[0], 0, sizeof (MYSQL_BIND) * n);
+
+      for (size_t j (0); j != n; ++j)
+      {
+        typedef odb::query_base::clause_part part;
+
+        const part& x (q.clause ()[sh.params[j]]);
+
+        query_param_factory f (
+          reinterpret_cast<query_param_factory> (
+            x.native_info[id_mysql].param_factory));
+
+        const odb::query_param* p (
+          reinterpret_cast<const odb::query_param*> (x.data));
+
+        parameters_.push_back (
+          f (p->value, x.kind == part::kind_param_ref));
+        parameters_.back ()->bind (&bind_[j]);
+      }
+
+      binding_.bind = &bind_[0];
+      binding_.count = n;
+      binding_.version++;
     }
   }
 }
@@ -2,7 +2,7 @@
 // license   : GNU GPL v2; see accompanying LICENSE file
 
 #include <cstddef> // std::size_t
-#include <cstring> // std::memset
+#include <cstring> // std::memset, std::strlen, std::strstr
 
 #include <odb/mysql/query.hxx>
 
@@ -24,6 +24,7 @@ namespace odb
     query_base::
     query_base (const query_base& q)
         : clause_ (q.clause_),
+          text_ (q.text_),
           parameters_ (q.parameters_),
           bind_ (q.bind_),
           binding_ (0, 0)
@@ -48,6 +49,7 @@ namespace odb
       if (this != &q)
       {
         clause_ = q.clause_;
+        text_ = q.text_;
         parameters_ = q.parameters_;
         bind_ = q.bind_;
 
@@ -60,12 +62,59 @@ namespace odb
       return *this;
     }
 
+    // Return true if a clause part of the specified kind that starts
+    // with the first character should be separated by a space from the
+    // text that ends with the last character.
+    //
+    static inline bool
+    separate (char last, query_base::clause_part::kind_type k, char first)
+    {
+      if (last == ' ' || last == '\n' || last == '(')
+        return false;
+
+      // We don't want extra spaces before ',' and ')' in native parts.
+      //
+      return k != query_base::clause_part::kind_native ||
+        (first != ' ' && first != '\n' && first != ',' && first != ')');
+    }
+
     query_base& query_base::
     operator+= (const query_base& q)
     {
+      size_t n (clause_.size ());
       clause_.insert (clause_.end (), q.clause_.begin (), q.clause_.end ());
 
-      size_t n (bind_.size ());
+      // Within q's text the parts are already separated from each other.
+      // We only need to separate the first non-empty one from our text and
+      // then adjust the positions.
+      //
+      clause_type::iterator i (clause_.begin () + n), e (clause_.end ());
+
+      for (; i != e && i->begin == i->end; ++i)
+        i->begin = i->end = text_.size ();
+
+      if (i != e)
+      {
+        size_t qb (i->begin);
+        char last (!text_.empty () ? text_[text_.size () - 1] : ' ');
+
+        if (separate (last, i->kind, q.text_[qb]))
+          text_ += ' ';
+
+        size_t b (text_.size ());
+        text_.append (q.text_, qb, string::npos);
+
+        for (; i != e; ++i)
+        {
+          i->begin = i->begin - qb + b;
+          i->end = i->end - qb + b;
+        }
+      }
+
+      if (n == 0 && !clause_.empty ())
+        update_prefix ();
+
+      size_t bn (bind_.size ());
 
       parameters_.insert (
         parameters_.end (), q.parameters_.begin (), q.parameters_.end ());
@@ -73,7 +122,7 @@ namespace odb
       bind_.insert (
         bind_.end (), q.bind_.begin (), q.bind_.end ());
 
-      if (n != bind_.size ())
+      if (bn != bind_.size ())
       {
         binding_.bind = &bind_[0];
         binding_.count = bind_.size ();
@@ -84,46 +133,124 @@ namespace odb
     }
 
     void query_base::
-    append (const string& q)
+    begin_part (const clause_part& p, char first)
+    {
+      char last (!text_.empty () ? text_[text_.size () - 1] : ' ');
+
+      if (separate (last, p.kind, first))
+        text_ += ' ';
+
+      clause_.push_back (p);
+      clause_.back ().begin = text_.size ();
+    }
+
+    void query_base::
+    end_part ()
     {
+      clause_.back ().end = text_.size ();
+
+      if (clause_.size () == 1)
+        update_prefix ();
+    }
+
+    void query_base::
+    append (const char* q)
+    {
+      append_native (q, strlen (q));
+    }
+
+    void query_base::
+    append_native (const char* q, size_t n)
+    {
+      char first (n != 0 ? q[0] : ' ');
+
       if (!clause_.empty () &&
           clause_.back ().kind == clause_part::kind_native)
       {
-        string& s (clause_.back ().part);
+        clause_part& p (clause_.back ());
+        char last (!text_.empty () ? text_[text_.size () - 1] : ' ');
 
-        char first (!q.empty () ? q[0] : ' ');
-        char last (!s.empty () ? s[s.size () - 1] : ' ');
+        if (separate (last, p.kind, first))
+          text_ += ' ';
 
-        // We don't want extra spaces after '(' as well as before ','
-        // and ')'.
+        // An empty part starts with the appended text.
         //
-        if (last != ' ' && last != '\n' && last != '(' &&
-            first != ' ' && first != '\n' && first != ',' && first != ')')
-          s += ' ';
+        if (p.begin == p.end)
+          p.begin = text_.size ();
 
-        s += q;
+        text_.append (q, n);
+        end_part ();
       }
       else
-        clause_.push_back (clause_part (clause_part::kind_native, q));
+      {
+        begin_part (clause_part (clause_part::kind_native), first);
+        text_.append (q, n);
+        end_part ();
+      }
     }
 
     void query_base::
     append (const char* table, const char* column)
     {
-      string s (table);
-      s += '.';
-      s += column;
+      begin_part (clause_part (clause_part::kind_column), table[0]);
+      text_ += table;
+      text_ += '.';
+      text_ += column;
+      end_part ();
+    }
+
+    void query_base::
+    reserve (const query_base& x, const query_base* y)
+    {
+      size_t parts (x.clause_.size () + 3);
+      size_t params (x.parameters_.size ());
+      size_t text (x.text_.size () + 16);
+
+      if (y != 0)
+      {
+        parts += y->clause_.size ();
+        params += y->parameters_.size ();
+        text += y->text_.size ();
+      }
+
+      clause_.reserve (clause_.size () + parts);
+      text_.reserve (text_.size () + text);
+
+      if (params != 0)
+      {
+        parameters_.reserve (parameters_.size () + params);
+
+        // Reserving can move the bind array.
+        //
+        MYSQL_BIND* b (bind_.empty () ? 0 : &bind_[0]);
+        bind_.reserve (bind_.size () + params);
 
-      clause_.push_back (clause_part (clause_part::kind_column, s));
+        if (b != 0 && b != &bind_[0])
+        {
+          binding_.bind = &bind_[0];
+          binding_.version++;
+        }
+      }
     }
 
     void query_base::
     append (details::shared_ptr<query_param> p, const char* conv)
     {
-      clause_.push_back (clause_part (clause_part::kind_param));
+      begin_part (clause_part (clause_part::kind_param), '?');
 
+      // Add the conversion expression, if any.
+      //
       if (conv != 0)
-        clause_.back ().part = conv;
+      {
+        const char* i (strstr (conv, "(?)"));
+        text_.append (conv, i - conv);
+        text_ += '?';
+        text_ += i + 3;
+      }
+      else
+        text_ += '?';
+
+      end_part ();
 
       parameters_.push_back (p);
       bind_.push_back (MYSQL_BIND ());
@@ -159,8 +286,10 @@ namespace odb
         binding_.version++;
     }
 
+    // Check the text of the clause part between b and e.
+    //
     static bool
-    check_prefix (const string& s)
+    check_prefix (const string& s, size_t b, size_t e)
     {
       string::size_type n;
 
@@ -168,23 +297,25 @@ namespace odb
       // rather than getting involved with the portable case-
       // insensitive string comparison mess.
       //
-      if (s.compare (0, (n = 5), "WHERE") == 0 ||
-          s.compare (0, (n = 5), "where") == 0 ||
-          s.compare (0, (n = 6), "SELECT") == 0 ||
-          s.compare (0, (n = 6), "select") == 0 ||
-          s.compare (0, (n = 8), "ORDER BY") == 0 ||
-          s.compare (0, (n = 8), "order by") == 0 ||
-          s.compare (0, (n = 8), "GROUP BY") == 0 ||
-          s.compare (0, (n = 8), "group by") == 0 ||
-          s.compare (0, (n = 6), "HAVING") == 0 ||
-          s.compare (0, (n = 6), "having") == 0 ||
-          s.compare (0, (n = 4), "CALL") == 0 ||
-          s.compare (0, (n = 4), "call") == 0)
+      if (s.compare (b, (n = 5), "WHERE") == 0 ||
+          s.compare (b, (n = 5), "where") == 0 ||
+          s.compare (b, (n = 6), "SELECT") == 0 ||
+          s.compare (b, (n = 6), "select") == 0 ||
+          s.compare (b, (n = 8), "ORDER BY") == 0 ||
+          s.compare (b, (n = 8), "order by") == 0 ||
+          s.compare (b, (n = 8), "GROUP BY") == 0 ||
+          s.compare (b, (n = 8), "group by") == 0 ||
+          s.compare (b, (n = 6), "HAVING") == 0 ||
+          s.compare (b, (n = 6), "having") == 0 ||
+          s.compare (b, (n = 4), "CALL") == 0 ||
+          s.compare (b, (n = 4), "call") == 0)
       {
         // It either has to be an exact match, or there should be
         // a whitespace following the keyword.
         //
-        if (s.size () == n || s[n] == ' ' || s[n] == '\n' || s[n] =='\t')
+        if (b + n == e ||
+            (b + n < e &&
+             (s[b + n] == ' ' || s[b + n] == '\n' || s[b + n] =='\t')))
           return true;
       }
 
@@ -206,8 +337,30 @@ namespace odb
         clause_type::iterator j (i + 1);
 
         if (j == e ||
-            (j->kind == clause_part::kind_native && check_prefix (j->part)))
+            (j->kind == clause_part::kind_native &&
+             check_prefix (text_, j->begin, j->end)))
+        {
           clause_.erase (i);
+
+          if (clause_.empty ())
+          {
+            text_.clear ();
+            return;
+          }
+
+          // Remove the prefix and the literal.
+          //
+          size_t b (clause_.front ().begin);
+          text_.erase (0, b);
+
+          for (i = clause_.begin (), e = clause_.end (); i != e; ++i)
+          {
+            i->begin -= b;
+            i->end -= b;
+          }
+
+          update_prefix ();
+        }
       }
     }
 
@@ -218,7 +371,8 @@ namespace odb
       {
         const clause_part& p (clause_.front ());
 
-        if (p.kind == clause_part::kind_native && check_prefix (p.part))
+        if (p.kind == clause_part::kind_native &&
+            check_prefix (text_, p.begin, p.end))
           return "";
 
         return "WHERE ";
@@ -227,76 +381,26 @@ namespace odb
       return "";
     }
 
-    string query_base::
-    clause () const
+    void query_base::
+    update_prefix ()
     {
-      string r;
+      // The first part starts right after the prefix.
+      //
+      size_t b (clause_.front ().begin);
+      const char* p (clause_prefix ());
+      size_t n (strlen (p));
 
-      for (clause_type::const_iterator i (clause_.begin ()),
-             end (clause_.end ());
-           i != end;
-           ++i)
+      if (n != b)
       {
-        char last (!r.empty () ? r[r.size () - 1] : ' ');
+        text_.replace (0, b, p, n);
 
-        switch (i->kind)
+        for (clause_type::iterator i (clause_.begin ()), e (clause_.end ());
+             i != e; ++i)
         {
-        case clause_part::kind_column:
-          {
-            if (last != ' ' && last != '\n' && last != '(')
-              r += ' ';
-
-            r += i->part;
-            break;
-          }
-        case clause_part::kind_param:
-          {
-            if (last != ' ' && last != '\n' && last != '(')
-              r += ' ';
-
-            // Add the conversion expression, if any.
-            //
-            string::size_type p (0);
-            if (!i->part.empty ())
-            {
-              p = i->part.find ("(?)");
-              r.append (i->part, 0, p);
-            }
-
-            r += '?';
-
-            if (!i->part.empty ())
-              r.append (i->part, p + 3, string::npos);
-
-            break;
-          }
-        case clause_part::kind_native:
-          {
-            // We don't want extra spaces after '(' as well as before ','
-            // and ')'.
-            //
-            const string& p (i->part);
-            char first (!p.empty () ? p[0] : ' ');
-
-            if (last != ' ' && last != '\n' && last != '(' &&
-                first != ' ' && first != '\n' && first != ',' && first != ')')
-              r += ' ';
-
-            r += p;
-            break;
-          }
-        case clause_part::kind_bool:
-          {
-            if (last != ' ' && last != '\n' && last != '(')
-              r += ' ';
-
-            r += i->bool_part ? "TRUE" : "FALSE";
-            break;
-          }
+          i->begin = i->begin - b + n;
+          i->end = i->end - b + n;
         }
       }
-
-      return clause_prefix () + r;
     }
 
     query_base
@@ -316,6 +420,7 @@ namespace odb
         return x;
 
       query_base r ("(");
+      r.reserve (x, &y);
       r += x;
       r += ") AND (";
       r += y;
@@ -327,6 +432,7 @@ namespace odb
     operator|| (const query_base& x, const query_base& y)
     {
       query_base r ("(");
+      r.reserve (x, &y);
       r += x;
       r += ") OR (";
       r += y;
@@ -338,6 +444,7 @@ namespace odb
     operator! (const query_base& x)
     {
       query_base r ("NOT (");
+      r.reserve (x);
       r += x;
       r += ")";
       return r;
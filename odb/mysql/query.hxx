@@ -141,14 +141,18 @@ namespace odb
           kind_bool
         };
 
-        clause_part (kind_type k): kind (k), bool_part (false) {}
-        clause_part (kind_type k, const std::string& p)
-            : kind (k), part (p), bool_part (false) {}
-        clause_part (bool p): kind (kind_bool), bool_part (p) {}
+        clause_part (kind_type k)
+            : kind (k), bool_part (false), begin (0), end (0) {}
+        clause_part (bool p)
+            : kind (kind_bool), bool_part (p), begin (0), end (0) {}
 
         kind_type kind;
-        std::string part; // If kind is param, then part is conversion expr.
         bool bool_part;
+
+        // Position of the part's text in the clause text.
+        //
+        std::size_t begin;
+        std::size_t end;
       };
 
       query_base ()
@@ -169,19 +173,23 @@ namespace odb
       query_base (const char* native)
         : binding_ (0, 0)
       {
-        clause_.push_back (clause_part (clause_part::kind_native, native));
+        append (native);
       }
 
       explicit
       query_base (const std::string& native)
         : binding_ (0, 0)
       {
-        clause_.push_back (clause_part (clause_part::kind_native, native));
+        append (native);
       }
 
+      // Column followed by an operator and a parameter is by far the
+      // most common case (see query_column).
+      //
       query_base (const char* table, const char* column)
         : binding_ (0, 0)
       {
+        clause_.reserve (3);
         append (table, column);
       }
 
@@ -233,8 +241,11 @@ namespace odb
       operator= (const query_base&);
 
     public:
-      std::string
-      clause () const;
+      const std::string&
+      clause () const
+      {
+        return text_;
+      }
 
       const char*
       clause_prefix () const;
@@ -399,26 +410,64 @@ namespace odb
       void
       append (bool v)
       {
-        clause_.push_back (clause_part (v));
+        begin_part (clause_part (v), 'T');
+        text_ += v ? "TRUE" : "FALSE";
+        end_part ();
       }
 
       void
-      append (const std::string& native);
-
-      void
-      append (const char* native) // Clashes with append(bool).
+      append (const std::string& native)
       {
-        append (std::string (native));
+        append_native (native.c_str (), native.size ());
       }
 
+      void
+      append (const char* native); // Clashes with append(bool).
+
       void
       append (const char* table, const char* column);
 
+      // Reserve space for appending x and, if not NULL, y plus a few
+      // native parts (parenthesis, operators, etc).
+      //
+      void
+      reserve (const query_base& x, const query_base* y = 0);
+
+    private:
+      // Add a new clause part separating it from the preceding text, if
+      // necessary. The first argument is the first character of the
+      // part's text.
+      //
+      void
+      begin_part (const clause_part&, char first);
+
+      // Finish the last clause part after its text has been appended.
+      //
+      void
+      end_part ();
+
+      void
+      append_native (const char*, std::size_t);
+
+      // Make sure the clause text starts with the WHERE prefix if one is
+      // required by the first clause part.
+      //
+      void
+      update_prefix ();
+
     private:
       typedef std::vector<clause_part> clause_type;
       typedef std::vector<details::shared_ptr<query_param> > parameters_type;
 
       clause_type clause_;
+
+      // Text of the clause, including the prefix, that is kept up to date
+      // as the parts are added. The clause parts only refer to it so that
+      // the text is stored once and clause() is an immutable operation
+      // that does not need to build anything.
+      //
+      std::string text_;
+
       parameters_type parameters_;
       mutable std::vector<MYSQL_BIND> bind_;
       mutable binding binding_;
@@ -1944,21 +1993,39 @@ namespace odb
     template <typename T>
     struct query_param_impl<T, id_string>: query_param
     {
-      query_param_impl (ref_bind<T> r) : query_param (r.ptr ()) {}
-      query_param_impl (val_bind<T> v) : query_param (0) {init (v.val);}
+      query_param_impl (ref_bind<T> r)
+          : query_param (r.ptr ()), data_ (0), capacity_ (0) {}
+
+      query_param_impl (val_bind<T> v)
+          : query_param (0), data_ (0), capacity_ (0) {init (v.val);}
 
       virtual bool
       init ()
       {
-        return init (*static_cast<const T*> (value_));
+        const T& v (*static_cast<const T*> (value_));
+
+        // Bind the referenced value in place if possible. It stays alive
+        // for the duration of the execution.
+        //
+        std::size_t n;
+        if (const char* d =
+            direct_image_traits<value_traits<T, id_string> >::image (v, n))
+        {
+          bool r (d != data_);
+          data_ = d;
+          size_ = capacity_ = static_cast<unsigned long> (n);
+          return r;
+        }
+
+        return init (v);
       }
 
       virtual void
       bind (MYSQL_BIND* b)
       {
         b->buffer_type = MYSQL_TYPE_STRING;
-        b->buffer = buffer_.data ();
-        b->buffer_length = static_cast<unsigned long> (buffer_.capacity ());
+        b->buffer = const_cast<char*> (data_);
+        b->buffer_length = capacity_;
         b->length = &size_;
       }
 
@@ -1967,15 +2034,21 @@ namespace odb
       init (typename decay_traits<T>::type v)
       {
         bool is_null (false); // Can't be NULL.
-        std::size_t size (0), cap (buffer_.capacity ());
+        std::size_t size (0);
         value_traits<T, id_string>::set_image (buffer_, size, is_null, v);
         size_ = static_cast<unsigned long> (size);
-        return cap != buffer_.capacity ();
+        capacity_ = static_cast<unsigned long> (buffer_.capacity ());
+
+        bool r (buffer_.data () != data_);
+        data_ = buffer_.data ();
+        return r;
       }
 
     private:
       details::buffer buffer_;
+      const char* data_;
       unsigned long size_;
+      unsigned long capacity_;
     };
 
     // BLOB
@@ -1983,21 +2056,39 @@ namespace odb
     template <typename T>
     struct query_param_impl<T, id_blob>: query_param
     {
-      query_param_impl (ref_bind<T> r) : query_param (r.ptr ()) {}
-      query_param_impl (val_bind<T> v) : query_param (0) {init (v.val);}
+      query_param_impl (ref_bind<T> r)
+          : query_param (r.ptr ()), data_ (0), capacity_ (0) {}
+
+      query_param_impl (val_bind<T> v)
+          : query_param (0), data_ (0), capacity_ (0) {init (v.val);}
 
       virtual bool
       init ()
       {
-        return init (*static_cast<const T*> (value_));
+        const T& v (*static_cast<const T*> (value_));
+
+        // Bind the referenced value in place if possible. It stays alive
+        // for the duration of the execution.
+        //
+        std::size_t n;
+        if (const char* d =
+            direct_image_traits<value_traits<T, id_blob> >::image (v, n))
+        {
+          bool r (d != data_);
+          data_ = d;
+          size_ = capacity_ = static_cast<unsigned long> (n);
+          return r;
+        }
+
+        return init (v);
       }
 
       virtual void
       bind (MYSQL_BIND* b)
       {
         b->buffer_type = MYSQL_TYPE_BLOB;
-        b->buffer = buffer_.data ();
-        b->buffer_length = static_cast<unsigned long> (buffer_.capacity ());
+        b->buffer = const_cast<char*> (data_);
+        b->buffer_length = capacity_;
         b->length = &size_;
       }
 
@@ -2006,15 +2097,21 @@ namespace odb
       init (typename decay_traits<T>::type v)
       {
         bool is_null (false); // Can't be NULL.
-        std::size_t size (0), cap (buffer_.capacity ());
+        std::size_t size (0);
         value_traits<T, id_blob>::set_image (buffer_, size, is_null, v);
         size_ = static_cast<unsigned long> (size);
-        return cap != buffer_.capacity ();
+        capacity_ = static_cast<unsigned long> (buffer_.capacity ());
+
+        bool r (buffer_.data () != data_);
+        data_ = buffer_.data ();
+        return r;
       }
 
     private:
       details::buffer buffer_;
+      const char* data_;
       unsigned long size_;
+      unsigned long capacity_;
     };
 
     // BIT
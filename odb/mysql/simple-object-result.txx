@@ -53,7 +53,7 @@ namespace odb
     {
       if (count_ > statement_->fetched ())
         fetch ();
-      else if (f && statement_->cached ())
+      else if (f && statement_->refetchable ())
       {
         // We have to re-load the image in case it has been overwritten
         // between the last time we fetched and this call to load().
@@ -98,7 +98,7 @@ namespace odb
     {
       if (count_ > statement_->fetched ())
         fetch ();
-      else if (statement_->cached ())
+      else if (statement_->refetchable ())
       {
         // We have to re-load the image in case it has been overwritten
         // between the last time we fetched and this call to load_id().
@@ -121,11 +121,13 @@ namespace odb
       // If we are cached, simply increment the position and
       // postpone the actual row fetching until later. This way
       // if the same object is loaded in between iteration, the
-      // image won't be messed up.
+      // image won't be messed up. If the result is read in
+      // windows, then we don't know the size so we have to fetch
+      // (the row can still be re-fetched from the window).
       //
       count_++;
 
-      if (statement_->cached ())
+      if (statement_->cached () && !statement_->windowed ())
         this->end_ = count_ > statement_->result_size ();
       else
         fetch ();
@@ -138,10 +140,10 @@ namespace odb
     void object_result_impl<T>::
     fetch (bool next)
     {
-      // If the result is cached, the image can grow between calls
+      // If the result is refetchable, the image can grow between calls
       // to fetch() as a result of other statements execution.
       //
-      if (statement_->cached ())
+      if (statement_->refetchable ())
       {
         typename object_traits::image_type& im (statements_.image ());
 
@@ -208,7 +210,7 @@ namespace odb
       {
         statement_->cache ();
 
-        if (count_ == statement_->result_size ())
+        if (!statement_->windowed () && count_ == statement_->result_size ())
         {
           statement_->free_result ();
           count_++; // One past the result size.
@@ -223,7 +225,7 @@ namespace odb
     {
       if (!this->end_)
       {
-        if (!statement_->cached ())
+        if (!statement_->cached () || statement_->windowed ())
           throw result_not_cached ();
 
         return statement_->result_size ();
@@ -161,7 +161,9 @@ namespace odb
       typedef T object_type;
       typedef object_traits_impl<object_type, id_mysql> object_traits;
 
-      optimistic_data (MYSQL_BIND*);
+      optimistic_data (MYSQL_BIND*,
+                       std::size_t skip,
+                       unsigned long long* status);
 
       binding*
       id_image_binding () {return &id_image_binding_;}
@@ -176,7 +178,7 @@ namespace odb
     template <typename T>
     struct optimistic_data<T, false>
     {
-      optimistic_data (MYSQL_BIND*) {}
+      optimistic_data (MYSQL_BIND*, std::size_t, unsigned long long*) {}
 
       binding*
       id_image_binding () {return 0;}
@@ -282,7 +284,7 @@ namespace odb
       // Object image.
       //
       image_type&
-      image () {return image_;}
+      image (std::size_t i = 0) {return images_[i].obj;}
 
       // Insert binding.
       //
@@ -329,7 +331,7 @@ namespace odb
       // Object id image and binding.
       //
       id_image_type&
-      id_image () {return id_image_;}
+      id_image (std::size_t i = 0) {return images_[i].id;}
 
       std::size_t
       id_image_version () const {return id_image_version_;}
@@ -377,7 +379,8 @@ namespace odb
               false,                    // Don't optimize.
               id_image_binding_,
               select_image_binding_,
-              false));
+              false,                    // Don't copy text.
+              false));                  // No cursor.
 
         return *find_;
       }
@@ -434,11 +437,15 @@ namespace odb
       {
         return extra_statement_cache_.get (
           conn_,
-          image_, id_image_,
+          images_[0].obj, images_[0].id,
           id_image_binding_, od_.id_image_binding ());
       }
 
     public:
+      // Maximum number of objects in a bulk operation.
+      //
+      static const std::size_t batch = object_traits::batch;
+
       // select = total - separate_load
       // insert = total - inverse - managed_optimistic
       // update = total - inverse - managed_optimistic - id - readonly
@@ -485,7 +492,19 @@ namespace odb
                                 image_type,
                                 id_image_type> extra_statement_cache_;
 
-      image_type image_;
+      // Object and id images for each object in a batch. They are kept
+      // together so that the size of this struct can be used as the skip
+      // value to get from one id image to the next.
+      //
+      template <typename I, typename ID>
+      struct images
+      {
+        I obj;
+        ID id;
+      };
+
+      images<image_type, id_image_type> images_[batch];
+      unsigned long long status_[batch];
 
       // Select binding.
       //
@@ -494,14 +513,15 @@ namespace odb
       MYSQL_BIND select_image_bind_[select_column_count];
       my_bool select_image_truncated_[select_column_count];
 
-      // Insert binding.
+      // Insert binding. For bulk persist each object image in the batch
+      // has its own set of bind entries.
       //
       std::size_t insert_image_version_;
       binding insert_image_binding_;
-      MYSQL_BIND insert_image_bind_[insert_column_count];
+      MYSQL_BIND insert_image_bind_[insert_column_count * batch];
 
-      // Update binding. Note that the id suffix is bound to id_image_
-      // below instead of image_ which makes this binding effectively
+      // Update binding. Note that the id suffix is bound to the id image
+      // instead of the object image which makes this binding effectively
       // bound to two images. As a result, we have to track versions
       // for both of them. If this object uses optimistic concurrency,
       // then the binding for the managed column (version, timestamp,
@@ -514,10 +534,9 @@ namespace odb
       MYSQL_BIND update_image_bind_[update_column_count + id_column_count +
                                     managed_optimistic_column_count];
 
-      // Id image binding (only used as a parameter). Uses the suffix in
-      // the update bind.
+      // Id image binding (only used as a parameter or to return the
+      // auto-assigned id). Uses the suffix in the update bind.
       //
-      id_image_type id_image_;
       std::size_t id_image_version_;
       binding id_image_binding_;
 
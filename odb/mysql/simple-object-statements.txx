@@ -19,11 +19,16 @@ namespace odb
 
     template <typename T>
     optimistic_data<T, true>::
-    optimistic_data (MYSQL_BIND* b)
+    optimistic_data (MYSQL_BIND* b,
+                     std::size_t skip,
+                     unsigned long long* status)
         : id_image_binding_ (
             b,
             object_traits::id_column_count +
-            object_traits::managed_optimistic_column_count)
+            object_traits::managed_optimistic_column_count,
+            object_traits::batch,
+            skip,
+            status)
     {
     }
 
@@ -42,21 +47,36 @@ namespace odb
     object_statements (connection_type& conn)
         : object_statements_base (conn),
           select_image_binding_ (select_image_bind_, select_column_count),
-          insert_image_binding_ (insert_image_bind_, insert_column_count),
+          insert_image_binding_ (insert_image_bind_,
+                                 insert_column_count,
+                                 batch,
+                                 0,
+                                 status_),
           update_image_binding_ (update_image_bind_,
                                  update_column_count + id_column_count +
-                                 managed_optimistic_column_count),
+                                 managed_optimistic_column_count,
+                                 batch,
+                                 sizeof (images<image_type, id_image_type>),
+                                 status_),
           id_image_binding_ (update_image_bind_ + update_column_count,
-                             id_column_count),
-          od_ (update_image_bind_ + update_column_count)
+                             id_column_count,
+                             batch,
+                             sizeof (images<image_type, id_image_type>),
+                             status_),
+          od_ (update_image_bind_ + update_column_count,
+               sizeof (images<image_type, id_image_type>),
+               status_)
     {
-      image_.version = 0;
+      for (std::size_t i (0); i < batch; ++i)
+      {
+        images_[i].obj.version = 0;
+        images_[i].id.version = 0;
+      }
+
       select_image_version_ = 0;
       insert_image_version_ = 0;
       update_image_version_ = 0;
       update_id_image_version_ = 0;
-
-      id_image_.version = 0;
       id_image_version_ = 0;
 
       std::memset (insert_image_bind_, 0, sizeof (insert_image_bind_));
@@ -0,0 +1,55 @@
+// file      : odb/mysql/statement-cache.cxx
+// license   : GNU GPL v2; see accompanying LICENSE file
+
+#include <map>
+
+#include <odb/details/lock.hxx>
+#include <odb/details/mutex.hxx>
+#include <odb/details/type-info.hxx>
+
+#include <odb/mysql/statement-cache.hxx>
+
+using namespace std;
+
+namespace odb
+{
+  using namespace details;
+
+  namespace mysql
+  {
+    typedef map<const type_info*, size_t, type_info_comparator> slot_map;
+
+    // Construct on first use since slots are normally assigned during
+    // static initialization.
+    //
+    static slot_map&
+    slot_map_ ()
+    {
+      static slot_map m;
+      return m;
+    }
+
+    static mutex&
+    slot_mutex_ ()
+    {
+      static mutex m;
+      return m;
+    }
+
+    size_t statement_cache::
+    slot (const type_info& ti)
+    {
+      lock l (slot_mutex_ ());
+
+      slot_map& m (slot_map_ ());
+      slot_map::iterator i (m.find (&ti));
+
+      if (i != m.end ())
+        return i->second;
+
+      size_t r (m.size () + 1); // 0 means not yet assigned.
+      m.insert (slot_map::value_type (&ti, r));
+      return r;
+    }
+  }
+}
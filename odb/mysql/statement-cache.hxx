@@ -6,7 +6,8 @@
 
 #include <odb/pre.hxx>
 
-#include <map>
+#include <vector>
+#include <cstddef>  // std::size_t
 #include <typeinfo>
 
 #include <odb/forward.hxx>
@@ -17,7 +18,6 @@
 #include <odb/mysql/statements-base.hxx>
 
 #include <odb/details/shared-ptr.hxx>
-#include <odb/details/type-info.hxx>
 
 #include <odb/mysql/details/export.hxx>
 
@@ -42,13 +42,43 @@ namespace odb
       find_view ();
 
     private:
-      typedef std::map<const std::type_info*,
-                       details::shared_ptr<statements_base>,
-                       details::type_info_comparator> map;
+      // Each object and view type is assigned a slot index once per
+      // process so that the lookup is just indexing into the vector. The
+      // index is normally assigned during static initialization.
+      //
+      template <typename T>
+      struct type_slot
+      {
+        static std::size_t index;
+      };
+
+      template <typename T>
+      static std::size_t
+      slot ()
+      {
+        std::size_t& i (type_slot<T>::index);
+
+        // Static initialization order in case we are called before the
+        // index has been initialized.
+        //
+        if (i == 0)
+          i = slot (typeid (T));
+
+        return i;
+      }
+
+      // Return the slot index (starting from 1) for the type. The same
+      // type always gets the same index even if it is instantiated in
+      // several modules (the types are compared by name).
+      //
+      static std::size_t
+      slot (const std::type_info&);
+
+      typedef std::vector<details::shared_ptr<statements_base> > slots;
 
       connection& conn_;
       unsigned int version_seq_;
-      map map_;
+      slots slots_;
     };
   }
 }
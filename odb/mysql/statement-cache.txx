@@ -7,6 +7,10 @@ namespace odb
 {
   namespace mysql
   {
+    template <typename T>
+    std::size_t statement_cache::type_slot<T>::
+    index (statement_cache::slot (typeid (T)));
+
     template <typename T>
     typename object_traits_impl<T, id_mysql>::statements_type&
     statement_cache::
@@ -22,19 +26,22 @@ namespace odb
       //
       if (version_seq_ != conn_.database ().schema_version_sequence ())
       {
-        map_.clear ();
+        slots_.clear ();
         version_seq_ = conn_.database ().schema_version_sequence ();
       }
 
-      map::iterator i (map_.find (&typeid (T)));
+      std::size_t i (slot<T> ());
 
-      if (i != map_.end ())
-        return static_cast<statements_type&> (*i->second);
+      if (i < slots_.size () && slots_[i] != 0)
+        return static_cast<statements_type&> (*slots_[i]);
 
       details::shared_ptr<statements_type> p (
         new (details::shared) statements_type (conn_));
 
-      map_.insert (map::value_type (&typeid (T), p));
+      if (i >= slots_.size ())
+        slots_.resize (i + 1);
+
+      slots_[i] = p;
       return *p;
     }
 
@@ -45,15 +52,18 @@ namespace odb
       // We don't cache any statements for views so no need to clear
       // the cache.
 
-      map::iterator i (map_.find (&typeid (T)));
+      std::size_t i (slot<T> ());
 
-      if (i != map_.end ())
-        return static_cast<view_statements<T>&> (*i->second);
+      if (i < slots_.size () && slots_[i] != 0)
+        return static_cast<view_statements<T>&> (*slots_[i]);
 
       details::shared_ptr<view_statements<T> > p (
         new (details::shared) view_statements<T> (conn_));
 
-      map_.insert (map::value_type (&typeid (T), p));
+      if (i >= slots_.size ())
+        slots_.resize (i + 1);
+
+      slots_[i] = p;
       return *p;
     }
   }
@@ -1,7 +1,7 @@
 // file      : odb/mysql/statement.cxx
 // license   : GNU GPL v2; see accompanying LICENSE file
 
-#include <cstring> // std::strlen, std::memmove, std::memset
+#include <cstring> // std::strlen, std::memcpy, std::memset
 #include <cassert>
 
 #include <odb/tracer.hxx>
@@ -10,6 +10,7 @@
 #include <odb/mysql/database.hxx>
 #include <odb/mysql/connection.hxx>
 #include <odb/mysql/statement.hxx>
+#include <odb/mysql/long-data.hxx>
 #include <odb/mysql/error.hxx>
 
 using namespace std;
@@ -27,7 +28,7 @@ namespace odb
                statement_kind sk,
                const binding* process,
                bool optimize)
-        : conn_ (conn)
+        : conn_ (conn), reset_ (false), prepared_prev_ (0), prepared_next_ (0)
     {
       if (process == 0)
       {
@@ -47,7 +48,7 @@ namespace odb
                const binding* process,
                bool optimize,
                bool copy)
-        : conn_ (conn)
+        : conn_ (conn), reset_ (false), prepared_prev_ (0), prepared_next_ (0)
     {
       size_t n;
 
@@ -108,6 +109,26 @@ namespace odb
       if (*text_ == '\0')
         return;
 
+      // Reuse a handle from the query statement cache if there is one
+      // for this text.
+      //
+      if (sk == statement_select)
+      {
+        if (MYSQL_STMT* h = conn_.cached_stmt_handle (text_, text_size))
+        {
+          stmt_.reset (h);
+          reset_ = false;
+          conn_.statement_prepared (*this, true);
+          return;
+        }
+      }
+
+      prepare_ (text_size);
+    }
+
+    void statement::
+    prepare_ (size_t text_size)
+    {
       stmt_.reset (conn_.alloc_stmt_handle ());
 
       conn_.clear ();
@@ -123,62 +144,110 @@ namespace odb
       if (mysql_stmt_prepare (stmt_,
                               text_,
                               static_cast<unsigned long> (text_size)) != 0)
+      {
+        // Leave the statement unprepared.
+        //
+        auto_handle<MYSQL_STMT> h (stmt_.release ());
+        translate_error (conn_, h);
+      }
+
+      reset_ = false;
+      conn_.statement_prepared (*this);
+    }
+
+    void statement::
+    reset ()
+    {
+      if (reset_ && mysql_stmt_reset (stmt_))
         translate_error (conn_, stmt_);
+
+      reset_ = true;
     }
 
-    size_t statement::
-    process_bind (MYSQL_BIND* b, size_t n)
+    bool statement::
+    releasable () const
     {
-      size_t shifts (0);
-      for (MYSQL_BIND* e (b + n); b != e;)
-      {
-        if (b->buffer == 0)
-        {
-          // It is possible that this array has already been processed
-          // (shared among multiple statements).
-          //
-          if (b->length != 0)
-          {
-            n -= e - b;
-            break;
-          }
+      return true;
+    }
 
-          e--;
+    bool statement::
+    release ()
+    {
+      if (stmt_ == 0 || conn_.active () == this || !releasable ())
+        return false;
 
-          // Shift the rest of the entries to the left.
-          //
-          memmove (b, b + 1, (e - b) * sizeof (MYSQL_BIND));
+      {
+        odb::tracer* t;
+        if ((t = conn_.transaction_tracer ()) ||
+            (t = conn_.tracer ()) ||
+            (t = conn_.database ().tracer ()))
+          t->deallocate (conn_, *this);
+      }
 
-          // Store the original position of the NULL entry at the end.
-          //
-          e->buffer = 0;
-          e->length = reinterpret_cast<unsigned long*> (b + shifts);
+      conn_.free_stmt_handle (stmt_); // May throw.
+      conn_.statement_released (*this);
+      return true;
+    }
+
+    void statement::
+    send_long_data_ (const MYSQL_BIND* b, size_t n)
+    {
+      vector<char> buf;
+      unsigned int p (0); // Parameter number.
 
-          shifts++;
+      for (const MYSQL_BIND* e (b + n); b != e; ++b)
+      {
+        if (b->buffer == 0) // Skip NULL entries (see process_bind()).
           continue;
+
+        if (long_data_source* s = conn_.take_long_data (b->buffer))
+        {
+          if (buf.empty ())
+            buf.resize (65536);
+
+          for (size_t r; (r = s->read (&buf[0], buf.size ())) != 0;)
+          {
+            if (mysql_stmt_send_long_data (
+                  stmt_, p, &buf[0], static_cast<unsigned long> (r)))
+              translate_error (conn_, stmt_);
+          }
         }
 
-        b++;
+        p++;
       }
-
-      return n - shifts;
     }
 
-    void statement::
-    restore_bind (MYSQL_BIND* b, size_t n)
+    MYSQL_BIND* statement::
+    process_bind (MYSQL_BIND* b, size_t n, size_t& count)
     {
-      for (MYSQL_BIND* e (b + n - 1); e->buffer == 0 && e->length != 0;)
+      // Most bindings have no NULL entries so first check for that in
+      // which case we can bind the original array.
+      //
+      size_t i (0);
+      for (; i != n && b[i].buffer != 0; ++i) ;
+
+      if (i == n)
       {
-        MYSQL_BIND* p (reinterpret_cast<MYSQL_BIND*> (e->length));
+        count = n;
+        return b;
+      }
 
-        // Shift the entries from the specified position to the right.
-        //
-        memmove (p + 1, p, (e - p) * sizeof (MYSQL_BIND));
+      bind_.assign (b, b + i);
 
-        // Restore the original NULL entry.
-        //
-        memset (p, 0, sizeof (MYSQL_BIND));
+      for (++i; i != n; ++i)
+      {
+        if (b[i].buffer != 0)
+          bind_.push_back (b[i]);
       }
+
+      count = bind_.size ();
+
+      // We still need a valid pointer if all the entries are NULL.
+      //
+      if (count == 0)
+        bind_.resize (1);
+
+      return &bind_[0];
     }
 
     statement::
@@ -198,6 +267,7 @@ namespace odb
         // may delay the actual freeing if it will mess up the currently
         // active statement).
         //
+        conn_.statement_released (*this);
         conn_.free_stmt_handle (stmt_);
       }
     }
@@ -220,6 +290,28 @@ namespace odb
     ~select_statement ()
     {
       assert (freed_);
+
+      // Keep the handle for reuse if the query statement cache is enabled
+      // (see connection::query_statement_cache()). The handle with the
+      // cursor attributes set is not reused since the next statement
+      // assumes there is no cursor. Neither is the handle that needs a
+      // reset since the next statement assumes it is clean.
+      //
+      if (stmt_ != 0 &&
+          prefetch_ == 0 &&
+          !reset_ &&
+          conn_.query_statement_cache () != 0)
+      {
+        {
+          odb::tracer* t;
+          if ((t = conn_.transaction_tracer ()) ||
+              (t = conn_.tracer ()) ||
+              (t = conn_.database ().tracer ()))
+            t->deallocate (conn_, *this);
+        }
+
+        conn_.cache_stmt_handle (*this);
+      }
     }
 
     select_statement::
@@ -228,7 +320,8 @@ namespace odb
                       bool process,
                       bool optimize,
                       binding& param,
-                      binding& result)
+                      binding& result,
+                      bool allow_cursor)
         : statement (conn,
                      text, statement_select,
                      (process ? &result : 0), optimize),
@@ -236,6 +329,11 @@ namespace odb
           cached_ (false),
           freed_ (true),
           rows_ (0),
+          cursor_allowed_ (allow_cursor),
+          prefetch_ (0),
+          cursor_ (false),
+          max_length_ (false),
+          window_ (0),
           param_ (&param),
           param_version_ (0),
           result_ (result),
@@ -250,7 +348,8 @@ namespace odb
                       bool optimize,
                       binding& param,
                       binding& result,
-                      bool copy_text)
+                      bool copy_text,
+                      bool allow_cursor)
         : statement (conn,
                      text, statement_select,
                      (process ? &result : 0), optimize,
@@ -259,6 +358,11 @@ namespace odb
           cached_ (false),
           freed_ (true),
           rows_ (0),
+          cursor_allowed_ (allow_cursor),
+          prefetch_ (0),
+          cursor_ (false),
+          max_length_ (false),
+          window_ (0),
           param_ (&param),
           param_version_ (0),
           result_ (result),
@@ -271,7 +375,8 @@ namespace odb
                       const string& text,
                       bool process,
                       bool optimize,
-                      binding& result)
+                      binding& result,
+                      bool allow_cursor)
         : statement (conn,
                      text, statement_select,
                      (process ? &result : 0), optimize),
@@ -279,6 +384,11 @@ namespace odb
           cached_ (false),
           freed_ (true),
           rows_ (0),
+          cursor_allowed_ (allow_cursor),
+          prefetch_ (0),
+          cursor_ (false),
+          max_length_ (false),
+          window_ (0),
           param_ (0),
           result_ (result),
           result_version_ (0)
@@ -291,7 +401,8 @@ namespace odb
                       bool process,
                       bool optimize,
                       binding& result,
-                      bool copy_text)
+                      bool copy_text,
+                      bool allow_cursor)
         : statement (conn,
                      text, statement_select,
                      (process ? &result : 0), optimize,
@@ -300,6 +411,11 @@ namespace odb
           cached_ (false),
           freed_ (true),
           rows_ (0),
+          cursor_allowed_ (allow_cursor),
+          prefetch_ (0),
+          cursor_ (false),
+          max_length_ (false),
+          window_ (0),
           param_ (0),
           result_ (result),
           result_version_ (0)
@@ -311,15 +427,48 @@ namespace odb
     {
       assert (freed_);
 
+      bool rebind (prepare ());
+
+      if (rebind)
+      {
+        // New handle without the cursor attributes and with nothing
+        // bound. Make sure the results are bound again in fetch().
+        //
+        prefetch_ = 0;
+        max_length_ = false;
+        result_version_ = result_.version - 1;
+      }
+
       conn_.clear ();
 
       end_ = false;
       rows_ = 0;
 
-      if (mysql_stmt_reset (stmt_))
-        translate_error (conn_, stmt_);
+      reset ();
 
-      if (param_ != 0 && param_version_ != param_->version)
+      // Switch the cursor mode if the connection setting has changed.
+      //
+      size_t p (cursor_allowed_ ? conn_.cursor_prefetch () : 0);
+      if (prefetch_ != p)
+      {
+        unsigned long t (
+          p != 0 ? CURSOR_TYPE_READ_ONLY : CURSOR_TYPE_NO_CURSOR);
+
+        if (mysql_stmt_attr_set (stmt_, STMT_ATTR_CURSOR_TYPE, &t))
+          translate_error (conn_, stmt_);
+
+        if (p != 0)
+        {
+          unsigned long n (static_cast<unsigned long> (p));
+
+          if (mysql_stmt_attr_set (stmt_, STMT_ATTR_PREFETCH_ROWS, &n))
+            translate_error (conn_, stmt_);
+        }
+
+        prefetch_ = p;
+      }
+
+      if (param_ != 0 && (rebind || param_version_ != param_->version))
       {
         // For now cannot have NULL entries.
         //
@@ -348,7 +497,26 @@ namespace odb
 #endif
 
       freed_ = false;
-      conn_.active (this);
+
+      // If the server has opened a cursor (it may decline to do so, for
+      // example, for a stored procedure call), then the rest of the
+      // result stays on the server and the connection is free for other
+      // statements.
+      //
+      cursor_ = prefetch_ != 0 &&
+        (conn_.handle ()->server_status & SERVER_STATUS_CURSOR_EXISTS) != 0;
+
+      // Read the cursor result in windows unless it is cached (see
+      // cache()) so that the current row can be re-fetched after other
+      // statements have been executed.
+      //
+      if (cursor_)
+      {
+        window_ = prefetch_;
+        window_begin_ = window_end_ = 0;
+      }
+      else
+        conn_.active (this);
     }
 
     void select_statement::
@@ -356,8 +524,35 @@ namespace odb
     {
       if (!cached_)
       {
+        // If nothing has been read from the cursor yet, then store the
+        // whole result instead (mysql_stmt_store_result() fetches the
+        // remaining rows from the cursor). Otherwise, keep reading it in
+        // windows.
+        //
+        if (window_ != 0 && window_end_ == 0)
+          window_ = 0;
+
+        if (window_ != 0)
+        {
+          cached_ = true;
+          return;
+        }
+
         if (!end_)
         {
+          // Have the maximum value lengths calculated so that we can
+          // pre-size the buffers (see presize_()).
+          //
+          if (!max_length_)
+          {
+            my_bool v (1);
+
+            if (mysql_stmt_attr_set (stmt_, STMT_ATTR_UPDATE_MAX_LENGTH, &v))
+              translate_error (conn_, stmt_);
+
+            max_length_ = true;
+          }
+
           if (mysql_stmt_store_result (stmt_))
             translate_error (conn_, stmt_);
 
@@ -378,7 +573,8 @@ namespace odb
     {
       if (result_version_ != result_.version)
       {
-        size_t count (process_bind (result_.bind, result_.count));
+        size_t count;
+        MYSQL_BIND* b (process_bind (result_.bind, result_.count, count));
 
         // Make sure that the number of columns in the result returned by
         // the database matches the number that we expect. A common cause
@@ -387,15 +583,32 @@ namespace odb
         //
         assert (mysql_stmt_field_count (stmt_) == count);
 
-        if (mysql_stmt_bind_result (stmt_, result_.bind))
+        if (mysql_stmt_bind_result (stmt_, b))
           translate_error (conn_, stmt_);
 
-        if (count != result_.count)
-          restore_bind (result_.bind, result_.count);
-
         result_version_ = result_.version;
       }
 
+      if (window_ != 0)
+      {
+        if (!next)
+        {
+          assert (rows_ != 0);
+          return load_row_ (rows_ - 1);
+        }
+
+        if (rows_ == window_end_)
+        {
+          if (!end_)
+            fill_window_ ();
+
+          if (rows_ == window_end_)
+            return no_data;
+        }
+
+        return load_row_ (rows_++);
+      }
+
       if (!next && rows_ != 0)
       {
         assert (cached_);
@@ -404,13 +617,16 @@ namespace odb
 
       int r (mysql_stmt_fetch (stmt_));
 
+      // Before returning the first row see if we can grow the buffers
+      // once for the whole result rather than on each truncation.
+      //
       switch (r)
       {
       case 0:
         {
           if (next)
             rows_++;
-          return success;
+          return next && rows_ == 1 && presize_ () ? truncated : success;
         }
       case MYSQL_NO_DATA:
         {
@@ -421,6 +637,10 @@ namespace odb
         {
           if (next)
             rows_++;
+
+          if (next && rows_ == 1)
+            presize_ ();
+
           return truncated;
         }
       default:
@@ -431,9 +651,223 @@ namespace odb
       }
     }
 
+    // Return the size of the fixed-length type or 0 if the type is of
+    // variable length.
+    //
+    static size_t
+    fixed_size (enum_field_types t)
+    {
+      switch (t)
+      {
+      case MYSQL_TYPE_TINY:
+        return 1;
+      case MYSQL_TYPE_SHORT:
+      case MYSQL_TYPE_YEAR:
+        return 2;
+      case MYSQL_TYPE_INT24:
+      case MYSQL_TYPE_LONG:
+      case MYSQL_TYPE_FLOAT:
+        return 4;
+      case MYSQL_TYPE_LONGLONG:
+      case MYSQL_TYPE_DOUBLE:
+        return 8;
+      case MYSQL_TYPE_DATE:
+      case MYSQL_TYPE_TIME:
+      case MYSQL_TYPE_DATETIME:
+      case MYSQL_TYPE_TIMESTAMP:
+        return sizeof (MYSQL_TIME);
+      default:
+        return 0;
+      }
+    }
+
+    void select_statement::
+    fill_window_ ()
+    {
+      window_begin_ = window_end_;
+      window_columns_.clear ();
+      window_data_.clear ();
+
+      window_count_ = 0;
+      for (size_t i (0); i < result_.count; ++i)
+      {
+        if (result_.bind[i].buffer != 0) // Skip NULL entries.
+          window_count_++;
+      }
+
+      for (; window_end_ - window_begin_ != window_; ++window_end_)
+      {
+        int r (mysql_stmt_fetch (stmt_));
+
+        if (r == MYSQL_NO_DATA)
+        {
+          end_ = true;
+          break;
+        }
+
+        if (r != 0 && r != MYSQL_DATA_TRUNCATED)
+          translate_error (conn_, stmt_);
+
+        unsigned int col (0);
+        for (size_t i (0); i < result_.count; ++i)
+        {
+          MYSQL_BIND& b (result_.bind[i]);
+
+          if (b.buffer == 0)
+            continue;
+
+          size_t fs (fixed_size (b.buffer_type));
+
+          column c;
+          c.offset = window_data_.size ();
+          c.is_null = *b.is_null;
+          c.length = c.is_null
+            ? 0
+            : (fs != 0 ? static_cast<unsigned long> (fs) : *b.length);
+
+          if (c.length != 0)
+          {
+            window_data_.resize (c.offset + c.length);
+            char* d (&window_data_[c.offset]);
+
+            if (b.error != 0 && *b.error)
+            {
+              // The value did not fit into the image buffer so fetch the
+              // whole thing directly into the window.
+              //
+              unsigned long l;
+              my_bool n, e;
+
+              MYSQL_BIND t (b);
+              t.buffer = d;
+              t.buffer_length = c.length;
+              t.length = &l;
+              t.is_null = &n;
+              t.error = &e;
+
+              if (mysql_stmt_fetch_column (stmt_, &t, col, 0))
+                translate_error (conn_, stmt_);
+            }
+            else
+              memcpy (d, b.buffer, c.length);
+          }
+
+          window_columns_.push_back (c);
+          col++;
+        }
+      }
+    }
+
+    select_statement::result select_statement::
+    load_row_ (size_t row)
+    {
+      assert (row >= window_begin_ && row < window_end_);
+
+      const column* c (
+        &window_columns_[(row - window_begin_) * window_count_]);
+      bool tr (false);
+
+      for (size_t i (0); i < result_.count; ++i)
+      {
+        MYSQL_BIND& b (result_.bind[i]);
+
+        if (b.buffer == 0)
+          continue;
+
+        bool t (false);
+        *b.is_null = c->is_null;
+
+        if (!c->is_null)
+        {
+          size_t fs (fixed_size (b.buffer_type));
+          size_t cap (fs != 0 ? fs : b.buffer_length);
+
+          if (b.length != 0)
+            *b.length = c->length;
+
+          t = c->length > cap;
+
+          if (c->length != 0)
+            memcpy (b.buffer, &window_data_[c->offset], t ? cap : c->length);
+        }
+
+        if (b.error != 0)
+          *b.error = t;
+
+        tr = tr || t;
+        c++;
+      }
+
+      return tr ? truncated : success;
+    }
+
+    bool select_statement::
+    presize_ ()
+    {
+      // We only know the longest value in each column if the result is
+      // cached (see cache()). Otherwise, let the buffers grow as longer
+      // values are encountered rather than pre-sizing them to the
+      // declared column length which can be much longer than the actual
+      // values (for example, VARCHAR(255) with a multi-byte character
+      // set).
+      //
+      if (!cached_ || !max_length_)
+        return false;
+
+      MYSQL_RES* m (mysql_stmt_result_metadata (stmt_));
+
+      if (m == 0)
+        return false;
+
+      const MYSQL_FIELD* f (mysql_fetch_fields (m));
+      bool r (false);
+
+      unsigned int col (0);
+      for (size_t i (0); i < result_.count; ++i)
+      {
+        MYSQL_BIND& b (result_.bind[i]);
+
+        if (b.buffer == 0) // Skip NULL entries.
+          continue;
+
+        // Skip columns that are not fetched with the row (zero-length
+        // buffer, see long_data_column).
+        //
+        if (fixed_size (b.buffer_type) == 0 && b.buffer_length != 0 &&
+            b.length != 0 && b.error != 0 && !*b.error)
+        {
+          unsigned long l (f[col].max_length);
+
+          // Pretend the value is truncated and has the maximum length.
+          // The caller will then grow the buffer to this length and
+          // refetch the column which restores its actual length.
+          //
+          if (l > b.buffer_length)
+          {
+            *b.length = l;
+            *b.error = 1;
+            r = true;
+          }
+        }
+
+        col++;
+      }
+
+      mysql_free_result (m);
+      return r;
+    }
+
     void select_statement::
     refetch ()
     {
+      // In the windowed mode the whole values are in the window.
+      //
+      if (window_ != 0)
+      {
+        load_row_ (rows_ - 1);
+        return;
+      }
+
       // Re-fetch columns that were truncated.
       //
       unsigned int col (0);
@@ -456,6 +890,30 @@ namespace odb
       }
     }
 
+    void select_statement::
+    fetch_column (unsigned int column, size_t offset, char* buf, size_t n)
+    {
+      assert (window_ == 0);
+
+      unsigned long l;
+      my_bool nl, e;
+
+      MYSQL_BIND b;
+      memset (&b, 0, sizeof (MYSQL_BIND));
+      b.buffer_type = MYSQL_TYPE_BLOB;
+      b.buffer = buf;
+      b.buffer_length = static_cast<unsigned long> (n);
+      b.length = &l;
+      b.is_null = &nl;
+      b.error = &e;
+
+      if (mysql_stmt_fetch_column (stmt_,
+                                   &b,
+                                   column,
+                                   static_cast<unsigned long> (offset)))
+        translate_error (conn_, stmt_);
+    }
+
     void select_statement::
     free_result ()
     {
@@ -535,13 +993,27 @@ namespace odb
         if (conn_.active () == this)
           conn_.active (0);
 
+        // Closing the server-side cursor requires a reset.
+        //
+        reset_ = cursor_;
+
         end_ = true;
         cached_ = false;
         freed_ = true;
         rows_ = 0;
+        cursor_ = false;
+        window_ = 0;
+        window_columns_.clear ();
+        window_data_.clear ();
       }
     }
 
+    bool select_statement::
+    releasable () const
+    {
+      return freed_;
+    }
+
     void select_statement::
     cancel ()
     {
@@ -572,6 +1044,7 @@ namespace odb
                      (process ? &param : 0), false),
           param_ (param),
           param_version_ (0),
+          param_set_ (0),
           returning_ (returning)
     {
     }
@@ -589,40 +1062,125 @@ namespace odb
                      copy_text),
           param_ (param),
           param_version_ (0),
+          param_set_ (0),
           returning_ (returning)
     {
     }
 
-    bool insert_statement::
-    execute ()
+    // Return the text of the multi-row INSERT statement for n sets. The
+    // VALUES clause is always last so we simply repeat everything after
+    // it.
+    //
+    static string
+    insert_batch_text (const char* text, size_t n)
     {
-      conn_.clear ();
+      string r (text);
 
-      if (mysql_stmt_reset (stmt_))
-        translate_error (conn_, stmt_);
+      string::size_type p (r.rfind ("VALUES"));
+      assert (p != string::npos);
+
+      p = r.find ('(', p);
+      assert (p != string::npos);
 
-      if (param_version_ != param_.version)
+      string v (r, p, string::npos);
+      r.reserve (r.size () + (v.size () + 1) * (n - 1));
+
+      for (size_t i (1); i != n; ++i)
       {
-        size_t count (process_bind (param_.bind, param_.count));
+        r += ',';
+        r += v;
+      }
 
-        if (mysql_stmt_bind_param (stmt_, param_.bind))
-          translate_error (conn_, stmt_);
+      return r;
+    }
 
-        if (count != param_.count)
-          restore_bind (param_.bind, param_.count);
+    insert_statement::
+    insert_statement (insert_statement& s, size_t n)
+        : statement (s.conn_,
+                     insert_batch_text (s.text_, n), statement_insert,
+                     0, false),
+          param_ (batch_param_),
+          param_version_ (0),
+          param_set_ (0),
+          returning_ (0)
+    {
+      batch_param_.bind = s.param_.bind;
+      batch_param_.count = s.param_.count * n;
+    }
 
-        param_version_ = param_.version;
-      }
+    // Store the auto-assigned id for the parameter set i in the returning
+    // binding.
+    //
+    static void
+    set_id (binding& r, size_t i, unsigned long long id)
+    {
+      MYSQL_BIND& b (r.bind[0]);
+      char* v (static_cast<char*> (b.buffer) + i * r.skip);
 
+      switch (b.buffer_type)
       {
-        odb::tracer* t;
-        if ((t = conn_.transaction_tracer ()) ||
-            (t = conn_.tracer ()) ||
-            (t = conn_.database ().tracer ()))
-          t->execute (conn_, *this);
+      case MYSQL_TYPE_TINY:
+        *reinterpret_cast<unsigned char*> (v) =
+          static_cast<unsigned char> (id);
+        break;
+      case MYSQL_TYPE_SHORT:
+        *reinterpret_cast<unsigned short*> (v) =
+          static_cast<unsigned short> (id);
+        break;
+      case MYSQL_TYPE_LONG:
+        *reinterpret_cast<unsigned int*> (v) =
+          static_cast<unsigned int> (id);
+        break;
+      case MYSQL_TYPE_LONGLONG:
+        *reinterpret_cast<unsigned long long*> (v) = id;
+        break;
+      default:
+        assert (false); // Auto id column type is not an integer.
       }
 
-      if (mysql_stmt_execute (stmt_))
+      *reinterpret_cast<my_bool*> (
+        reinterpret_cast<char*> (b.is_null) + i * r.skip) = false;
+    }
+
+    bool insert_statement::
+    execute ()
+    {
+      return execute_ (0, false);
+    }
+
+    bool insert_statement::
+    execute_ (size_t set, bool rebind)
+    {
+      if (prepare ())
+        rebind = true;
+
+      conn_.clear ();
+      reset ();
+
+      if (rebind || param_version_ != param_.version || param_set_ != set)
+      {
+        size_t count;
+        MYSQL_BIND* b (param_.bind + set * param_.count);
+        b = process_bind (b, param_.count, count);
+
+        if (mysql_stmt_bind_param (stmt_, b))
+          translate_error (conn_, stmt_);
+
+        param_version_ = param_.version;
+        param_set_ = set;
+      }
+
+      send_long_data (param_.bind + set * param_.count, param_.count);
+
+      {
+        odb::tracer* t;
+        if ((t = conn_.transaction_tracer ()) ||
+            (t = conn_.tracer ()) ||
+            (t = conn_.database ().tracer ()))
+          t->execute (conn_, *this);
+      }
+
+      if (mysql_stmt_execute (stmt_))
       {
         // An auto-assigned object id should never cause a duplicate
         // primary key.
@@ -633,35 +1191,126 @@ namespace odb
           translate_error (conn_, stmt_);
       }
 
+      reset_ = false;
+
       if (returning_ != 0)
+        set_id (*returning_, set, mysql_stmt_insert_id (stmt_));
+
+      return true;
+    }
+
+    // Record the error for the sets [b, e) of a batch in mex. Rethrow the
+    // current exception if mex is NULL.
+    //
+    static void
+    batch_error (multiple_exceptions* mex,
+                 const odb::exception& x,
+                 size_t b,
+                 size_t e)
+    {
+      if (mex == 0)
+        throw;
+
+      for (; b != e; ++b)
+        mex->insert (b, x, true);
+    }
+
+    size_t insert_statement::
+    execute (size_t n, multiple_exceptions* mex)
+    {
+      assert (n != 0 && n <= param_.batch);
+
+      // With streamed long data we may not be able to re-insert the rows
+      // one at a time (see below) since the data can only be read once.
+      // So in this case we insert them one at a time from the outset.
+      //
+      bool single (conn_.long_data_pending ());
+
+      // The auto_increment_increment value (cached by the connection).
+      //
+      unsigned long long inc (0);
+
+      for (size_t i (0); i != n;)
       {
-        unsigned long long i (mysql_stmt_insert_id (stmt_));
+        // Find the largest power of two that still fits.
+        //
+        size_t m (1), k (0);
+        for (; !single && m * 2 <= n - i; m *= 2, ++k) ;
 
-        MYSQL_BIND& b (returning_->bind[0]);
-        void* v (b.buffer);
+        size_t e (i + m); // End of this chunk.
+        size_t f (e);     // End of the sets that fail if we get an error.
 
-        switch (b.buffer_type)
+        try
         {
-        case MYSQL_TYPE_TINY:
-          *static_cast<unsigned char*> (v) = static_cast<unsigned char> (i);
-          break;
-        case MYSQL_TYPE_SHORT:
-          *static_cast<unsigned short*> (v) = static_cast<unsigned short> (i);
-          break;
-        case MYSQL_TYPE_LONG:
-          *static_cast<unsigned int*> (v) = static_cast<unsigned int> (i);
-          break;
-        case MYSQL_TYPE_LONGLONG:
-          *static_cast<unsigned long long*> (v) = i;
-          break;
-        default:
-          assert (false); // Auto id column type is not an integer.
-        }
+          if (m != 1)
+          {
+            if (batch_.size () < k)
+              batch_.resize (k);
+
+            details::shared_ptr<insert_statement>& s (batch_[k - 1]);
+
+            if (s == 0)
+              s.reset (new (details::shared) insert_statement (*this, m));
+
+            s->batch_param_.bind = param_.bind + i * param_.count;
+            s->batch_param_.version = param_.version;
+
+            // The chunks are bound to different sets so always rebind.
+            //
+            if (s->execute_ (0, true))
+            {
+              if (returning_ != 0)
+              {
+                // For a multi-row INSERT the number of rows is known
+                // upfront and the ids are allocated as a single range
+                // (spaced by auto_increment_increment) with the first one
+                // reported as the insert id.
+                //
+                unsigned long long id (mysql_stmt_insert_id (s->stmt_));
+
+                if (inc == 0)
+                  inc = conn_.auto_increment_increment ();
+
+                for (size_t j (i); j != e; ++j, id += inc)
+                  set_id (*returning_, j, id);
+              }
 
-        *b.is_null = false;
+              for (; i != e; ++i)
+                param_.status[i] = 1;
+
+              continue;
+            }
+
+            // One of the rows is a duplicate. The whole statement has
+            // been rolled back so re-insert the rows one at a time to
+            // find out which.
+            //
+          }
+
+          for (; i != e; ++i)
+          {
+            f = i + 1;
+            param_.status[i] = execute_ (i, false) ? 1 : 0;
+          }
+        }
+        catch (const odb::exception& x)
+        {
+          batch_error (mex, x, i, f);
+          return f;
+        }
       }
 
-      return true;
+      return n;
+    }
+
+    // Offset the pointer p (if not NULL) by n bytes.
+    //
+    template <typename T>
+    static inline void
+    offset (T*& p, size_t n)
+    {
+      if (p != 0)
+        p = reinterpret_cast<T*> (reinterpret_cast<char*> (p) + n);
     }
 
     // update_statement
@@ -681,7 +1330,9 @@ namespace odb
                      text, statement_update,
                      (process ? &param : 0), false),
           param_ (param),
-          param_version_ (0)
+          param_version_ (0),
+          param_set_ (0),
+          batch_bind_version_ (0)
     {
     }
 
@@ -696,31 +1347,314 @@ namespace odb
                      (process ? &param : 0), false,
                      copy_text),
           param_ (param),
-          param_version_ (0)
+          param_version_ (0),
+          param_set_ (0),
+          batch_bind_version_ (0)
+    {
+    }
+
+    static inline bool
+    space (char c)
+    {
+      return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    }
+
+    static string
+    trim (const string& s, string::size_type b, string::size_type e)
+    {
+      for (; b != e && space (s[b]); ++b) ;
+      for (; e != b && space (s[e - 1]); --e) ;
+      return string (s, b, e - b);
+    }
+
+    // Find the keyword that is surrounded by whitespaces.
+    //
+    static string::size_type
+    find_keyword (const string& s, const char* k, bool last)
+    {
+      size_t n (strlen (k));
+
+      for (string::size_type p (last ? s.rfind (k) : s.find (k));
+           p != string::npos;
+           p = (last
+                ? (p != 0 ? s.rfind (k, p - 1) : string::npos)
+                : s.find (k, p + 1)))
+      {
+        if (p != 0 && space (s[p - 1]) &&
+            p + n < s.size () && space (s[p + n]))
+          return p;
+      }
+
+      return string::npos;
+    }
+
+    // Split the string at the top-level (that is, outside quotes and
+    // parenthesis) occurrences of the separator and return the number
+    // of placeholders.
+    //
+    static size_t
+    split (const string& s, const char* sep, vector<string>* r)
+    {
+      size_t n (strlen (sep)), params (0);
+      string::size_type b (0);
+      char q ('\0');
+      size_t d (0);
+
+      for (string::size_type i (0); i != s.size (); ++i)
+      {
+        char c (s[i]);
+
+        if (q != '\0')
+        {
+          if (c == q)
+            q = '\0';
+
+          continue;
+        }
+
+        switch (c)
+        {
+        case '`':
+        case '\'':
+        case '"':
+          q = c;
+          break;
+        case '(':
+          d++;
+          break;
+        case ')':
+          d--;
+          break;
+        case '?':
+          params++;
+          break;
+        default:
+          if (r != 0 && d == 0 && s.compare (i, n, sep) == 0)
+          {
+            r->push_back (trim (s, b, i));
+            b = i + n;
+            i = b - 1;
+          }
+        }
+      }
+
+      if (r != 0)
+        r->push_back (trim (s, b, s.size ()));
+
+      return params;
+    }
+
+    namespace
+    {
+      struct update_part
+      {
+        string column;
+        string expr;  // Assigned expression or the whole condition.
+        size_t param; // First placeholder.
+        size_t count; // Number of placeholders.
+      };
+    }
+
+    typedef vector<update_part> update_parts;
+
+    static void
+    parse_parts (const string& s,
+                 const char* sep,
+                 bool assign,
+                 size_t& param,
+                 update_parts& r)
+    {
+      vector<string> v;
+      split (s, sep, &v);
+
+      for (vector<string>::iterator i (v.begin ()); i != v.end (); ++i)
+      {
+        string::size_type p (i->find ('='));
+        assert (p != string::npos);
+
+        update_part x;
+        x.column = trim (*i, 0, p);
+        x.expr = assign ? trim (*i, p + 1, i->size ()) : *i;
+        x.param = param;
+        x.count = split (*i, "", 0);
+
+        param += x.count;
+        r.push_back (x);
+      }
+    }
+
+    static void
+    append_part (string& r,
+                 const string& s,
+                 const update_part& x,
+                 size_t base,
+                 vector<size_t>* map)
+    {
+      r += s;
+
+      if (map != 0)
+      {
+        for (size_t i (0); i != x.count; ++i)
+          map->push_back (base + x.param + i);
+      }
+    }
+
+    // Return the text of the UPDATE statement that updates n sets and
+    // fill the map with the entry (set * count + parameter) for each
+    // placeholder.
+    //
+    static string
+    update_batch_text (const char* text, size_t n, vector<size_t>* map)
+    {
+      string s (text);
+
+      string::size_type sp (find_keyword (s, "SET", false));
+      string::size_type wp (find_keyword (s, "WHERE", true));
+      assert (sp != string::npos && wp != string::npos && sp < wp);
+
+      size_t count (0);
+      update_parts as, cs;
+      parse_parts (trim (s, sp + 3, wp), ",", true, count, as);
+      parse_parts (trim (s, wp + 5, s.size ()), " AND ", false, count, cs);
+
+      // Conditions that select the set inside CASE. They should not
+      // reference columns that are being updated.
+      //
+      vector<const update_part*> ks;
+      for (update_parts::const_iterator i (cs.begin ()); i != cs.end (); ++i)
+      {
+        update_parts::const_iterator j (as.begin ());
+        for (; j != as.end () && j->column != i->column; ++j) ;
+
+        if (j == as.end ())
+          ks.push_back (&*i);
+      }
+
+      assert (!ks.empty ());
+
+      // A single column comparison (object id) can use the simple CASE
+      // and IN forms.
+      //
+      bool simple (ks.size () == 1 && ks[0]->count == 1 &&
+                   ks[0]->expr == ks[0]->column + "=?");
+
+      string r (s, 0, sp + 3);
+      r.reserve (s.size () * n * 2);
+
+      for (update_parts::const_iterator i (as.begin ()); i != as.end (); ++i)
+      {
+        r += (i == as.begin () ? " " : ", ");
+        r += i->column;
+        r += "=CASE";
+
+        if (simple)
+        {
+          r += ' ';
+          r += ks[0]->column;
+        }
+
+        for (size_t j (0); j != n; ++j)
+        {
+          size_t base (j * count);
+
+          r += " WHEN ";
+
+          if (simple)
+            append_part (r, "?", *ks[0], base, map);
+          else
+          {
+            r += '(';
+            for (size_t k (0); k != ks.size (); ++k)
+              append_part (r, (k != 0 ? " AND " : "") + ks[k]->expr,
+                           *ks[k], base, map);
+            r += ')';
+          }
+
+          r += " THEN ";
+          append_part (r, i->expr, *i, base, map);
+        }
+
+        r += " ELSE ";
+        r += i->column;
+        r += " END";
+      }
+
+      r += " WHERE ";
+
+      if (simple && cs.size () == 1)
+      {
+        r += cs[0].column;
+        r += " IN (";
+
+        for (size_t j (0); j != n; ++j)
+          append_part (r, (j != 0 ? ",?" : "?"), cs[0], j * count, map);
+
+        r += ')';
+      }
+      else
+      {
+        for (size_t j (0); j != n; ++j)
+        {
+          r += (j != 0 ? " OR (" : "(");
+
+          for (update_parts::const_iterator i (cs.begin ());
+               i != cs.end ();
+               ++i)
+            append_part (r, (i != cs.begin () ? " AND " : "") + i->expr,
+                         *i, j * count, map);
+
+          r += ')';
+        }
+      }
+
+      return r;
+    }
+
+    update_statement::
+    update_statement (update_statement& s, size_t n)
+        : statement (s.conn_,
+                     update_batch_text (s.text_, n, 0),
+                     statement_update,
+                     0, false),
+          param_ (s.param_),
+          param_version_ (0),
+          param_set_ (0),
+          batch_bind_version_ (0)
     {
+      // The map member is not yet constructed when the base is
+      // initialized so we have to build the text one more time.
+      //
+      update_batch_text (s.text_, n, &batch_map_);
     }
 
     unsigned long long update_statement::
     execute ()
     {
-      conn_.clear ();
+      bool rebind (prepare ());
 
-      if (mysql_stmt_reset (stmt_))
-        translate_error (conn_, stmt_);
+      conn_.clear ();
+      reset ();
 
-      if (param_version_ != param_.version)
+      if (rebind || param_version_ != param_.version || param_set_ != 0)
       {
-        size_t count (process_bind (param_.bind, param_.count));
+        size_t count;
+        MYSQL_BIND* b (process_bind (param_.bind, param_.count, count));
 
-        if (mysql_stmt_bind_param (stmt_, param_.bind))
+        if (mysql_stmt_bind_param (stmt_, b))
           translate_error (conn_, stmt_);
 
-        if (count != param_.count)
-          restore_bind (param_.bind, param_.count);
-
         param_version_ = param_.version;
+        param_set_ = 0;
       }
 
+      send_long_data (param_.bind, param_.count);
+
+      return execute_ ();
+    }
+
+    unsigned long long update_statement::
+    execute_ ()
+    {
       {
         odb::tracer* t;
         if ((t = conn_.transaction_tracer ()) ||
@@ -737,9 +1671,123 @@ namespace odb
       if (r == static_cast<my_ulonglong> (-1))
         translate_error (conn_, stmt_);
 
+      reset_ = false;
       return static_cast<unsigned long long> (r);
     }
 
+    size_t update_statement::
+    execute (size_t n, multiple_exceptions* mex)
+    {
+      assert (n != 0 && n <= param_.batch);
+
+      // Lay out the bind entries for each set one after another, leaving
+      // out the NULL entries (see process_bind()).
+      //
+      if (batch_bind_version_ != param_.version || batch_bind_.empty ())
+      {
+        batch_bind_.clear ();
+        batch_bind_.reserve (param_.count * param_.batch);
+
+        for (size_t i (0); i != param_.batch; ++i)
+        {
+          const MYSQL_BIND* sb (
+            param_.skip != 0 ? param_.bind : param_.bind + i * param_.count);
+
+          for (size_t j (0); j != param_.count; ++j)
+          {
+            MYSQL_BIND b (sb[j]);
+
+            if (b.buffer == 0)
+              continue;
+
+            size_t o (i * param_.skip);
+            offset (b.buffer, o);
+            offset (b.length, o);
+            offset (b.is_null, o);
+            offset (b.error, o);
+
+            batch_bind_.push_back (b);
+          }
+        }
+
+        batch_bind_version_ = param_.version;
+      }
+
+      size_t c (batch_bind_.size () / param_.batch);
+      assert (c * param_.batch == batch_bind_.size ());
+
+      for (size_t i (0); i != n;)
+      {
+        // Find the largest power of two that still fits.
+        //
+        size_t m (1), k (0);
+        for (; m * 2 <= n - i; m *= 2, ++k) ;
+
+        unsigned long long r;
+
+        try
+        {
+          update_statement* s (this);
+          MYSQL_BIND* b (&batch_bind_[i * c]);
+
+          if (m != 1)
+          {
+            if (batch_.size () < k)
+              batch_.resize (k);
+
+            details::shared_ptr<update_statement>& p (batch_[k - 1]);
+
+            if (p == 0)
+              p.reset (new (details::shared) update_statement (*this, m));
+
+            s = p.get ();
+
+            // Arrange the entries in the placeholder order.
+            //
+            vector<size_t>& map (s->batch_map_);
+            s->batch_bind_.resize (map.size ());
+
+            for (size_t j (0); j != map.size (); ++j)
+              s->batch_bind_[j] = b[map[j]];
+
+            b = &s->batch_bind_[0];
+          }
+
+          s->prepare ();
+          conn_.clear ();
+          s->reset ();
+
+          // The chunks are bound to different sets so always rebind.
+          //
+          if (mysql_stmt_bind_param (s->stmt_, b))
+            translate_error (conn_, s->stmt_);
+
+          s->send_long_data (b, s == this ? c : s->batch_bind_.size ());
+
+          if (s == this)
+          {
+            param_version_ = param_.version;
+            param_set_ = i;
+          }
+
+          r = s->execute_ ();
+        }
+        catch (const odb::exception& x)
+        {
+          batch_error (mex, x, i, i + m);
+          return i + m;
+        }
+
+        unsigned long long st (
+          r == m ? 1 : (r == 0 ? 0 : result_unknown));
+
+        for (size_t e (i + m); i != e; ++i)
+          param_.status[i] = st;
+      }
+
+      return n;
+    }
+
     // delete_statement
     //
 
@@ -756,7 +1804,9 @@ namespace odb
                      text, statement_delete,
                      0, false),
           param_ (param),
-          param_version_ (0)
+          param_version_ (0),
+          param_set_ (0),
+          batch_bind_version_ (0)
     {
     }
 
@@ -770,26 +1820,99 @@ namespace odb
                      0, false,
                      copy_text),
           param_ (param),
-          param_version_ (0)
+          param_version_ (0),
+          param_set_ (0),
+          batch_bind_version_ (0)
+    {
+    }
+
+    // Return the text of the DELETE statement that matches n sets. If
+    // the condition is a single column comparison, then we turn it into
+    // IN. Otherwise (composite id, optimistic concurrency version), we
+    // repeat it with OR.
+    //
+    static string
+    delete_batch_text (const char* text, size_t n)
+    {
+      string r (text);
+
+      string::size_type p (r.rfind ("WHERE "));
+      assert (p != string::npos);
+      p += 6;
+
+      string c (r, p, string::npos);
+      r.resize (p);
+
+      if (c.find (" AND ") == string::npos &&
+          c.size () > 2 && c.compare (c.size () - 2, 2, "=?") == 0)
+      {
+        r.reserve (p + c.size () + 2 * n + 4);
+        r.append (c, 0, c.size () - 2);
+        r += " IN (?";
+
+        for (size_t i (1); i != n; ++i)
+          r += ",?";
+
+        r += ')';
+      }
+      else
+      {
+        r.reserve (p + (c.size () + 6) * n);
+
+        for (size_t i (0); i != n; ++i)
+        {
+          if (i != 0)
+            r += " OR ";
+
+          r += '(';
+          r += c;
+          r += ')';
+        }
+      }
+
+      return r;
+    }
+
+    delete_statement::
+    delete_statement (delete_statement& s, size_t n)
+        : statement (s.conn_,
+                     delete_batch_text (s.text_, n), statement_delete,
+                     0, false),
+          param_ (s.param_),
+          param_version_ (0),
+          param_set_ (0),
+          batch_bind_version_ (0)
     {
     }
 
     unsigned long long delete_statement::
     execute ()
     {
-      conn_.clear ();
+      unsigned long long r (
+        execute_ (param_.bind,
+                  param_version_ != param_.version || param_set_ != 0));
 
-      if (mysql_stmt_reset (stmt_))
-        translate_error (conn_, stmt_);
+      param_version_ = param_.version;
+      param_set_ = 0;
+
+      return r;
+    }
 
-      if (param_version_ != param_.version)
+    unsigned long long delete_statement::
+    execute_ (MYSQL_BIND* b, bool rebind)
+    {
+      if (prepare ())
+        rebind = true;
+
+      conn_.clear ();
+      reset ();
+
+      if (rebind)
       {
         // Cannot have NULL entries for now.
         //
-        if (mysql_stmt_bind_param (stmt_, param_.bind))
+        if (mysql_stmt_bind_param (stmt_, b))
           translate_error (conn_, stmt_);
-
-        param_version_ = param_.version;
       }
 
       {
@@ -808,7 +1931,95 @@ namespace odb
       if (r == static_cast<my_ulonglong> (-1))
         translate_error (conn_, stmt_);
 
+      reset_ = false;
       return static_cast<unsigned long long> (r);
     }
+
+    size_t delete_statement::
+    execute (size_t n, multiple_exceptions* mex)
+    {
+      assert (n != 0 && n <= param_.batch);
+
+      size_t c (param_.count);
+
+      // For the skip layout expand the bind entries into one set per
+      // object.
+      //
+      if (param_.skip != 0 &&
+          (batch_bind_version_ != param_.version || batch_bind_.empty ()))
+      {
+        batch_bind_.resize (c * param_.batch);
+
+        for (size_t i (0); i != param_.batch; ++i)
+        {
+          for (size_t j (0); j != c; ++j)
+          {
+            MYSQL_BIND& b (batch_bind_[i * c + j]);
+            b = param_.bind[j];
+
+            size_t o (i * param_.skip);
+            offset (b.buffer, o);
+            offset (b.length, o);
+            offset (b.is_null, o);
+            offset (b.error, o);
+          }
+        }
+
+        batch_bind_version_ = param_.version;
+      }
+
+      for (size_t i (0); i != n;)
+      {
+        // Find the largest power of two that still fits.
+        //
+        size_t m (1), k (0);
+        for (; m * 2 <= n - i; m *= 2, ++k) ;
+
+        MYSQL_BIND* b (param_.skip != 0
+                       ? &batch_bind_[i * c]
+                       : param_.bind + i * c);
+
+        unsigned long long r;
+
+        try
+        {
+          if (m == 1)
+          {
+            r = execute_ (
+              b, param_version_ != param_.version || param_set_ != i);
+
+            param_version_ = param_.version;
+            param_set_ = i;
+          }
+          else
+          {
+            if (batch_.size () < k)
+              batch_.resize (k);
+
+            details::shared_ptr<delete_statement>& s (batch_[k - 1]);
+
+            if (s == 0)
+              s.reset (new (details::shared) delete_statement (*this, m));
+
+            // The chunks are bound to different sets so always rebind.
+            //
+            r = s->execute_ (b, true);
+          }
+        }
+        catch (const odb::exception& x)
+        {
+          batch_error (mex, x, i, i + m);
+          return i + m;
+        }
+
+        unsigned long long st (
+          r == m ? 1 : (r == 0 ? 0 : result_unknown));
+
+        for (size_t e (i + m); i != e; ++i)
+          param_.status[i] = st;
+      }
+
+      return n;
+    }
   }
 }
@@ -7,9 +7,14 @@
 #include <odb/pre.hxx>
 
 #include <string>
+#include <vector>
 #include <cstddef>  // std::size_t
+#include <cstring>  // std::strlen
 
 #include <odb/statement.hxx>
+#include <odb/exceptions.hxx>
+
+#include <odb/details/shared-ptr.hxx>
 
 #include <odb/mysql/mysql.hxx>
 #include <odb/mysql/version.hxx>
@@ -34,6 +39,10 @@ namespace odb
       virtual
       ~statement () = 0;
 
+      // Note that the handle is NULL if the statement has been released
+      // by the connection (see connection::max_prepared_statements()).
+      // It is prepared again on the next execution.
+      //
       MYSQL_STMT*
       handle () const
       {
@@ -57,7 +66,7 @@ namespace odb
       bool
       empty () const
       {
-        return stmt_ == 0;
+        return *text_ == '\0';
       }
 
       // Cancel the statement execution (e.g., result fetching) so
@@ -66,6 +75,13 @@ namespace odb
       virtual void
       cancel ();
 
+      // Release the prepared statement handle unless the statement
+      // is in use (for example, has a pending result). Return true
+      // if the handle has been released.
+      //
+      bool
+      release ();
+
     protected:
       // We keep two versions to take advantage of std::string COW.
       //
@@ -82,17 +98,60 @@ namespace odb
                  bool optimize,
                  bool copy_text);
 
-      // Process the bind array so that all non-NULL entries are at
-      // the beginning. Return the actual number of bound columns.
+      // Make sure the statement is prepared and mark it as the most
+      // recently used. Should be called before executing the statement.
+      // Return true if the statement had to be re-prepared, in which
+      // case the parameters and results have to be bound again.
+      //
+      bool
+      prepare ()
+      {
+        if (stmt_ != 0)
+        {
+          conn_.statement_used (*this);
+          return false;
+        }
+
+        prepare_ (std::strlen (text_));
+        return true;
+      }
+
+      // Reset the statement if there could be something left over from
+      // the previous execution (pending result, open cursor, long data,
+      // or error). Should be called before binding the parameters. The
+      // statement is then considered dirty until the execution completes
+      // successfully (see reset_).
       //
-      static std::size_t
-      process_bind (MYSQL_BIND*, std::size_t n);
+      void
+      reset ();
 
-      // Restore the original locations of the NULL entries in the bind
-      // array.
+      // Send the streamed long data (see long_data) for the parameters
+      // in the bind array. Should be called after the statement has been
+      // reset and the parameters bound.
       //
-      static void
-      restore_bind (MYSQL_BIND*, std::size_t n);
+      void
+      send_long_data (const MYSQL_BIND* b, std::size_t n)
+      {
+        if (conn_.long_data_pending ())
+          send_long_data_ (b, n);
+      }
+
+      // Return false if the statement handle cannot be released right
+      // now.
+      //
+      virtual bool
+      releasable () const;
+
+      // Return the bind array with the NULL entries (absent or soft-
+      // deleted columns) left out and the actual number of bound columns
+      // in count. If there are no NULL entries, then this is the original
+      // array. Otherwise, the non-NULL entries are copied to bind_ (the
+      // client library copies the array when binding so it does not
+      // need to stay valid after that) and the original array is left
+      // unchanged.
+      //
+      MYSQL_BIND*
+      process_bind (MYSQL_BIND*, std::size_t n, std::size_t& count);
 
     private:
       void
@@ -101,11 +160,32 @@ namespace odb
             const binding* process,
             bool optimize);
 
+      void
+      prepare_ (std::size_t text_size);
+
+      void
+      send_long_data_ (const MYSQL_BIND*, std::size_t);
+
     protected:
       connection_type& conn_;
       std::string text_copy_;
       const char* text_;
       auto_handle<MYSQL_STMT> stmt_;
+
+      std::vector<MYSQL_BIND> bind_; // See process_bind().
+
+      // True if mysql_stmt_reset() has to be called before the next
+      // execution. A freshly prepared handle doesn't need it.
+      //
+      bool reset_;
+
+    private:
+      friend class mysql::connection;
+
+      // Connection's prepared statement list.
+      //
+      statement* prepared_prev_;
+      statement* prepared_next_;
     };
 
     class LIBODB_MYSQL_EXPORT select_statement: public statement
@@ -114,12 +194,18 @@ namespace odb
       virtual
       ~select_statement ();
 
+      // If allow_cursor is false, then the statement never opens a
+      // server-side cursor (see connection::cursor_prefetch()). This is
+      // the case for the statements that load objects, containers, and
+      // sections.
+      //
       select_statement (connection_type& conn,
                         const std::string& text,
                         bool process_text,
                         bool optimize_text,
                         binding& param,
-                        binding& result);
+                        binding& result,
+                        bool allow_cursor = true);
 
       select_statement (connection_type& conn,
                         const char* text,
@@ -127,20 +213,23 @@ namespace odb
                         bool optimize_text,
                         binding& param,
                         binding& result,
-                        bool copy_text = true);
+                        bool copy_text = true,
+                        bool allow_cursor = true);
 
       select_statement (connection_type& conn,
                         const std::string& text,
                         bool process_text,
                         bool optimize_text,
-                        binding& result);
+                        binding& result,
+                        bool allow_cursor = true);
 
       select_statement (connection_type& conn,
                         const char* text,
                         bool process_text,
                         bool optimize_text,
                         binding& result,
-                        bool copy_text = true);
+                        bool copy_text = true,
+                        bool allow_cursor = true);
 
       enum result
       {
@@ -152,6 +241,16 @@ namespace odb
       void
       execute ();
 
+      // Cache the result. The whole result is stored on the client, even
+      // if the statement has opened a server-side cursor (see
+      // connection::cursor_prefetch()). If the result is not cached and
+      // there is a cursor, then the result is read in windows of the
+      // prefetch size: the rows are read into memory owned by the
+      // statement one window at a time and the previous window is
+      // released when the iteration moves past it. If this function is
+      // called after the rows have started to be read in windows, then
+      // the result stays windowed.
+      //
       void
       cache ();
 
@@ -161,7 +260,27 @@ namespace odb
         return cached_;
       }
 
-      // Can only be called on a cached result.
+      // Return true if the result is read in windows. In this case the
+      // result size is not known and only the current row can be
+      // re-fetched.
+      //
+      bool
+      windowed () const
+      {
+        return window_ != 0;
+      }
+
+      // Return true if the current row can be re-fetched, which is the
+      // case if the result is cached or read in windows. Other statements
+      // can then be executed between the fetches.
+      //
+      bool
+      refetchable () const
+      {
+        return cached_ || window_ != 0;
+      }
+
+      // Can only be called on a cached result that is not windowed.
       //
       std::size_t
       result_size () const
@@ -179,7 +298,7 @@ namespace odb
 
       // Fetch next or current row depending on the next argument.
       // Note that fetching of the current row is only supported
-      // if the result is cached.
+      // if the result is refetchable.
       //
       result
       fetch (bool next = true);
@@ -187,22 +306,74 @@ namespace odb
       void
       refetch ();
 
+      // Read n bytes of the column value in the current row starting from
+      // the offset. The column index does not count the NULL entries in
+      // the result binding. Not supported for windowed results.
+      //
+      void
+      fetch_column (unsigned int column,
+                    std::size_t offset,
+                    char* buffer,
+                    std::size_t n);
+
       void
       free_result ();
 
       virtual void
       cancel ();
 
+    protected:
+      virtual bool
+      releasable () const;
+
     private:
       select_statement (const select_statement&);
       select_statement& operator= (const select_statement&);
 
+      // Read the next window of rows.
+      //
+      void
+      fill_window_ ();
+
+      // Copy a row from the window into the result binding.
+      //
+      result
+      load_row_ (std::size_t row);
+
+      // If the result is cached, mark the variable-length result columns
+      // whose buffers are smaller than the longest value as truncated.
+      // Return true if there are any.
+      //
+      bool
+      presize_ ();
+
     private:
       bool end_;
       bool cached_;
       bool freed_;
       std::size_t rows_;
       std::size_t size_;
+      bool cursor_allowed_;  // See the allow_cursor argument.
+      std::size_t prefetch_; // Cursor prefetch rows or 0 if no cursor.
+      bool cursor_;          // Server-side cursor is open.
+      bool max_length_;      // STMT_ATTR_UPDATE_MAX_LENGTH is set.
+
+      // Windowed cache. The column values for each row in the window are
+      // stored in the data buffer.
+      //
+      struct column
+      {
+        std::size_t offset;
+        unsigned long length;
+        my_bool is_null;
+      };
+
+      std::size_t window_;       // Window size or 0 if not windowed.
+      std::size_t window_begin_; // First row in the window.
+      std::size_t window_end_;   // One past the last row in the window.
+      std::size_t window_count_; // Number of columns in each row.
+      std::vector<column> window_columns_;
+      std::vector<char> window_data_;
 
 #if MYSQL_VERSION_ID >= 50503
       bool out_params_;
@@ -253,15 +424,66 @@ namespace odb
       bool
       execute ();
 
+      // Insert the first n parameter sets of the batch binding. The sets
+      // are split into power-of-two chunks, each inserted with a single
+      // multi-row INSERT statement. The statements for each chunk size
+      // are prepared once and cached. If the statement has the returning
+      // binding, then the auto-assigned ids are stored for each set.
+      //
+      // Return the number of parameter sets (out of n) that were
+      // attempted. The outcome for each attempted set can then be queried
+      // with result(). An error other than a duplicate row is fatal: if
+      // mex is not NULL, then it is recorded there for the sets that were
+      // not inserted because of it and otherwise it is thrown.
+      //
+      // If one of the rows in a chunk turns out to be a duplicate, the
+      // rows of this chunk are re-inserted one at a time in order to
+      // determine which. This relies on the whole multi-row statement
+      // being rolled back on error, which is only the case for
+      // transactional storage engines (for example, InnoDB). With a
+      // non-transactional engine (for example, MyISAM) the rows that
+      // precede the duplicate stay inserted and are then either inserted
+      // again (if the id is auto-assigned) or reported as duplicates. As
+      // a result, bulk persist should not be used with such tables.
+      //
+      std::size_t
+      execute (std::size_t n, multiple_exceptions* mex = 0);
+
+      // Return true if the parameter set i from the last batch execution
+      // was inserted and false if it is a duplicate. Not meaningful for
+      // a set for which an error was recorded.
+      //
+      bool
+      result (std::size_t i) const
+      {
+        return param_.status[i] != 0;
+      }
+
     private:
       insert_statement (const insert_statement&);
       insert_statement& operator= (const insert_statement&);
 
+      // Create the multi-row version of the statement for n sets.
+      //
+      insert_statement (insert_statement&, std::size_t n);
+
+      bool
+      execute_ (std::size_t set, bool rebind);
+
     private:
       binding& param_;
       std::size_t param_version_;
+      std::size_t param_set_; // Currently bound parameter set.
 
       binding* returning_;
+
+      // Statements for chunks of 2, 4, 8, etc., sets.
+      //
+      std::vector<details::shared_ptr<insert_statement> > batch_;
+
+      // For a chunk statement, the binding that covers all its sets.
+      //
+      binding batch_param_;
     };
 
     class LIBODB_MYSQL_EXPORT update_statement: public statement
@@ -284,13 +506,72 @@ namespace odb
       unsigned long long
       execute ();
 
+      // Update the rows identified by the first n parameter sets of the
+      // batch binding. The sets are split into power-of-two chunks, each
+      // updated with a single statement of the form:
+      //
+      // UPDATE t SET c = CASE WHEN <cond 1> THEN ? WHEN <cond 2> THEN ?
+      // ELSE c END, ... WHERE <cond 1> OR <cond 2> ...
+      //
+      // The CASE conditions only reference the columns that are not
+      // updated by the statement (for example, the object id but not
+      // the optimistic concurrency version) since MySQL evaluates the
+      // assignments left to right. The statements for each chunk size
+      // are prepared once and cached.
+      //
+      // Return the number of parameter sets (out of n) that were
+      // attempted. An error is fatal: if mex is not NULL, then it is
+      // recorded there for every set in the failed chunk and otherwise
+      // it is thrown.
+      //
+      std::size_t
+      execute (std::size_t n, multiple_exceptions* mex = 0);
+
+      // Return 1 if the row for the parameter set i from the last batch
+      // execution was found and 0 otherwise. Since we only get the total
+      // number of matched rows for each chunk, if only some of the rows
+      // in a chunk were found, then the result for all the sets in this
+      // chunk is unknown.
+      //
+      static const unsigned long long result_unknown = ~0ULL;
+
+      unsigned long long
+      result (std::size_t i) const
+      {
+        return param_.status[i];
+      }
+
     private:
       update_statement (const update_statement&);
       update_statement& operator= (const update_statement&);
 
+      // Create the version of the statement that updates n sets.
+      //
+      update_statement (update_statement&, std::size_t n);
+
+      unsigned long long
+      execute_ ();
+
     private:
       binding& param_;
       std::size_t param_version_;
+      std::size_t param_set_; // Currently bound parameter set.
+
+      // Statements for chunks of 2, 4, 8, etc., sets.
+      //
+      std::vector<details::shared_ptr<update_statement> > batch_;
+
+      // For this statement, the bind entries (without the NULL entries)
+      // for each set laid out one after another. For a chunk statement,
+      // the entries in the order of the placeholders in its text.
+      //
+      std::vector<MYSQL_BIND> batch_bind_;
+      std::size_t batch_bind_version_;
+
+      // For a chunk statement, the index of the entry (set * count +
+      // parameter) for each placeholder.
+      //
+      std::vector<std::size_t> batch_map_;
     };
 
     class LIBODB_MYSQL_EXPORT delete_statement: public statement
@@ -311,13 +592,60 @@ namespace odb
       unsigned long long
       execute ();
 
+      // Delete the rows identified by the first n parameter sets of the
+      // batch binding. The sets are split into power-of-two chunks, each
+      // deleted with a single DELETE statement that matches all the sets
+      // in the chunk (using IN if there is only one id column and OR
+      // otherwise). The statements for each chunk size are prepared once
+      // and cached.
+      //
+      // Return the number of parameter sets (out of n) that were
+      // attempted. An error is fatal: if mex is not NULL, then it is
+      // recorded there for every set in the failed chunk and otherwise
+      // it is thrown.
+      //
+      std::size_t
+      execute (std::size_t n, multiple_exceptions* mex = 0);
+
+      // Return 1 if the row for the parameter set i from the last batch
+      // execution was deleted and 0 if it was not found. Since we only
+      // get the total number of affected rows for each chunk, if only
+      // some of the rows in a chunk were found, then the result for all
+      // the sets in this chunk is unknown.
+      //
+      static const unsigned long long result_unknown = ~0ULL;
+
+      unsigned long long
+      result (std::size_t i) const
+      {
+        return param_.status[i];
+      }
+
     private:
       delete_statement (const delete_statement&);
       delete_statement& operator= (const delete_statement&);
 
+      // Create the version of the statement that matches n sets.
+      //
+      delete_statement (delete_statement&, std::size_t n);
+
+      unsigned long long
+      execute_ (MYSQL_BIND*, bool rebind);
+
     private:
       binding& param_;
       std::size_t param_version_;
+      std::size_t param_set_; // Currently bound parameter set.
+
+      // Statements for chunks of 2, 4, 8, etc., sets.
+      //
+      std::vector<details::shared_ptr<delete_statement> > batch_;
+
+      // If the parameter binding uses the skip layout, then this is the
+      // bind entries for each set laid out one after another.
+      //
+      std::vector<MYSQL_BIND> batch_bind_;
+      std::size_t batch_bind_version_;
     };
   }
 }
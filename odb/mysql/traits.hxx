@@ -383,6 +383,18 @@ namespace odb
                  std::size_t& n,
                  bool& is_null,
                  const std::string&);
+
+      // Return the image representation that can be bound directly,
+      // without copying it into the buffer (see direct_image_traits).
+      //
+      typedef void direct_image_tag;
+
+      static const char*
+      direct_image (const std::string& v, std::size_t& n)
+      {
+        n = v.size ();
+        return v.data ();
+      }
     };
 
     template <>
@@ -629,6 +641,15 @@ namespace odb
                  std::size_t& n,
                  bool& is_null,
                  const value_type&);
+
+      typedef void direct_image_tag;
+
+      static const char*
+      direct_image (const value_type& v, std::size_t& n)
+      {
+        n = v.size ();
+        return n != 0 ? &v.front () : "";
+      }
     };
 
     // std::vector<unsigned char> (buffer) specialization.
@@ -663,6 +684,68 @@ namespace odb
                  std::size_t& n,
                  bool& is_null,
                  const value_type&);
+
+      typedef void direct_image_tag;
+
+      static const char*
+      direct_image (const value_type& v, std::size_t& n)
+      {
+        n = v.size ();
+        return n != 0 ? reinterpret_cast<const char*> (&v.front ()) : "";
+      }
+    };
+
+    // Direct image binding. If the value traits provide direct_image()
+    // (marked with direct_image_tag), then a by-reference value can be
+    // bound in place for the duration of the statement execution instead
+    // of being copied into the image buffer. Custom value traits that
+    // don't provide it are always copied.
+    //
+    // Note that only by-reference query parameters (query_base::_ref())
+    // are bound this way. The object images (persist, update, etc) are
+    // initialized with set_image() and are always copied since the image
+    // may outlive the value. To write a large BLOB or TEXT object member
+    // without copying it, use long_data (see long-data.hxx).
+    //
+    template <typename VT>
+    struct has_direct_image
+    {
+      typedef char yes[1];
+      typedef char no[2];
+
+      template <typename U>
+      static yes&
+      test (typename U::direct_image_tag*);
+
+      template <typename U>
+      static no&
+      test (...);
+
+      static const bool value = sizeof (test<VT> (0)) == sizeof (yes);
+    };
+
+    template <typename VT, bool = has_direct_image<VT>::value>
+    struct direct_image_traits
+    {
+      // Return NULL if the value cannot be bound directly.
+      //
+      template <typename T>
+      static const char*
+      image (const T&, std::size_t&)
+      {
+        return 0;
+      }
+    };
+
+    template <typename VT>
+    struct direct_image_traits<VT, true>
+    {
+      template <typename T>
+      static const char*
+      image (const T& v, std::size_t& n)
+      {
+        return VT::direct_image (v, n);
+      }
     };
 
     // char[N] (buffer) specialization.
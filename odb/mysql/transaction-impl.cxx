@@ -1,6 +1,8 @@
 // file      : odb/mysql/transaction-impl.cxx
 // license   : GNU GPL v2; see accompanying LICENSE file
 
+#include <cstring> // std::strlen
+
 #include <odb/tracer.hxx>
 
 #include <odb/mysql/mysql.hxx>
@@ -9,19 +11,23 @@
 #include <odb/mysql/error.hxx>
 #include <odb/mysql/transaction-impl.hxx>
 
+using namespace std;
+
 namespace odb
 {
   namespace mysql
   {
     transaction_impl::
-    transaction_impl (database_type& db)
-        : odb::transaction_impl (db)
+    transaction_impl (database_type& db, const transaction_options& o)
+        : odb::transaction_impl (db), options_ (o)
     {
     }
 
     transaction_impl::
-    transaction_impl (connection_ptr c)
-        : odb::transaction_impl (c->database (), *c), connection_ (c)
+    transaction_impl (connection_ptr c, const transaction_options& o)
+        : odb::transaction_impl (c->database (), *c),
+          connection_ (c),
+          options_ (o)
     {
     }
 
@@ -37,20 +43,119 @@ namespace odb
       //
       if (connection_ == 0)
       {
-        connection_ = static_cast<database_type&> (database_).connection ();
+        database_type& db (static_cast<database_type&> (database_));
+
+        connection_ = options_.read_only
+          ? db.read_only_connection ()
+          : db.connection ();
+
         odb::transaction_impl::connection_ = connection_.get ();
       }
 
+      // Change the session isolation level if necessary (see
+      // transaction_options).
+      //
+      connection_->isolation (options_.isolation);
+
+      // The current autocommit mode is reported by the server with each
+      // response so we don't need to query it.
+      //
+      bool ac ((connection_->handle ()->server_status &
+                SERVER_STATUS_AUTOCOMMIT) != 0);
+
+      // In the lazy begin mode the server starts the transaction with the
+      // first statement (see connection::lazy_begin()). This cannot be
+      // done if the transaction has to be started with options.
+      //
+      bool ro (options_.read_only), cs (options_.consistent_snapshot);
+
+      if (connection_->lazy_begin ())
+      {
+        if (!ro && !cs)
+        {
+          if (ac)
+            autocommit (false);
+          else if ((connection_->handle ()->server_status &
+                    SERVER_STATUS_IN_TRANS) != 0)
+          {
+            // The statements executed outside of a transaction have
+            // started one implicitly. Commit it, as BEGIN would in the
+            // normal mode, so that this transaction starts afresh (and
+            // with the isolation level set above).
+            //
+            {
+              odb::tracer* t;
+              if ((t = connection_->tracer ()) || (t = database_.tracer ()))
+                t->execute (*connection_, "COMMIT");
+            }
+
+            if (mysql_real_query (connection_->handle (), "commit", 6) != 0)
+              translate_error (*connection_);
+          }
+
+          return;
+        }
+      }
+      // Restore autocommit if the lazy begin mode has been switched off.
+      //
+      else if (!ac)
+        autocommit (true);
+
+      if (!ro && !cs)
+      {
+        {
+          odb::tracer* t;
+          if ((t = connection_->tracer ()) || (t = database_.tracer ()))
+            t->execute (*connection_, "BEGIN");
+        }
+
+        if (mysql_real_query (connection_->handle (), "begin", 5) != 0)
+          translate_error (*connection_);
+
+        return;
+      }
+
+      const char* s (
+        ro && cs ? "START TRANSACTION WITH CONSISTENT SNAPSHOT, READ ONLY" :
+        ro       ? "START TRANSACTION READ ONLY" :
+                   "START TRANSACTION WITH CONSISTENT SNAPSHOT");
+
+      {
+        odb::tracer* t;
+        if ((t = connection_->tracer ()) || (t = database_.tracer ()))
+          t->execute (*connection_, s);
+      }
+
+      if (mysql_real_query (connection_->handle (),
+                            s,
+                            static_cast<unsigned long> (strlen (s))) != 0)
+        translate_error (*connection_);
+    }
+
+    void transaction_impl::
+    autocommit (bool v)
+    {
       {
         odb::tracer* t;
         if ((t = connection_->tracer ()) || (t = database_.tracer ()))
-          t->execute (*connection_, "BEGIN");
+          t->execute (*connection_,
+                      v ? "SET autocommit=1" : "SET autocommit=0");
       }
 
-      if (mysql_real_query (connection_->handle (), "begin", 5) != 0)
+      if (mysql_autocommit (connection_->handle (), v ? 1 : 0))
         translate_error (*connection_);
     }
 
+    bool transaction_impl::
+    active () const
+    {
+      // In the lazy begin mode there is nothing to end if no statement
+      // has been executed in the transaction.
+      //
+      return !connection_->lazy_begin () ||
+        (connection_->handle ()->server_status & SERVER_STATUS_IN_TRANS) != 0;
+    }
+
     void transaction_impl::
     commit ()
     {
@@ -63,16 +168,20 @@ namespace odb
       // thrown, this may not be the case.
       //
       connection_->clear ();
+      connection_->clear_long_data ();
 
+      if (active ())
       {
-        odb::tracer* t;
-        if ((t = connection_->tracer ()) || (t = database_.tracer ()))
-          t->execute (*connection_, "COMMIT");
+        {
+          odb::tracer* t;
+          if ((t = connection_->tracer ()) || (t = database_.tracer ()))
+            t->execute (*connection_, "COMMIT");
+        }
+
+        if (mysql_real_query (connection_->handle (), "commit", 6) != 0)
+          translate_error (*connection_);
       }
 
-      if (mysql_real_query (connection_->handle (), "commit", 6) != 0)
-        translate_error (*connection_);
-
       // Release the connection.
       //
       connection_.reset ();
@@ -90,16 +199,20 @@ namespace odb
       // thrown, this may not be the case.
       //
       connection_->clear ();
+      connection_->clear_long_data ();
 
+      if (active ())
       {
-        odb::tracer* t;
-        if ((t = connection_->tracer ()) || (t = database_.tracer ()))
-          t->execute (*connection_, "ROLLBACK");
+        {
+          odb::tracer* t;
+          if ((t = connection_->tracer ()) || (t = database_.tracer ()))
+            t->execute (*connection_, "ROLLBACK");
+        }
+
+        if (mysql_real_query (connection_->handle (), "rollback", 8) != 0)
+          translate_error (*connection_);
       }
 
-      if (mysql_real_query (connection_->handle (), "rollback", 8) != 0)
-        translate_error (*connection_);
-
       // Release the connection.
       //
       connection_.reset ();
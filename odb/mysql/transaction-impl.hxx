@@ -17,14 +17,64 @@ namespace odb
 {
   namespace mysql
   {
+    // Transaction characteristics (see database::begin() and
+    // connection::begin()). For example:
+    //
+    // transaction_options o;
+    // o.read_only = true;
+    // o.isolation = transaction_options::read_committed;
+    //
+    // transaction t (db.begin (o));
+    //
+    // The isolation level is set for the session and the connection keeps
+    // track of it so that it is only changed (which costs an extra round
+    // trip) when it differs from the level of the previous transaction on
+    // this connection. The default level means the server's default. It
+    // is restored when a transaction with the default level is started
+    // and when the connection is returned to the pool (see
+    // connection::reset_session()).
+    //
+    class transaction_options
+    {
+    public:
+      enum isolation_type
+      {
+        isolation_default,
+        read_uncommitted,
+        read_committed,
+        repeatable_read,
+        serializable
+      };
+
+      transaction_options ()
+          : read_only (false),
+            consistent_snapshot (false),
+            isolation (isolation_default)
+      {
+      }
+
+      // START TRANSACTION READ ONLY (MySQL 5.6.5 and later).
+      //
+      bool read_only;
+
+      // START TRANSACTION WITH CONSISTENT SNAPSHOT.
+      //
+      bool consistent_snapshot;
+
+      isolation_type isolation;
+    };
+
     class LIBODB_MYSQL_EXPORT transaction_impl: public odb::transaction_impl
     {
     public:
       typedef mysql::database database_type;
       typedef mysql::connection connection_type;
 
-      transaction_impl (database_type&);
-      transaction_impl (connection_ptr);
+      transaction_impl (database_type&,
+                        const transaction_options& = transaction_options ());
+
+      transaction_impl (connection_ptr,
+                        const transaction_options& = transaction_options ());
 
       virtual
       ~transaction_impl ();
@@ -38,8 +88,18 @@ namespace odb
       virtual void
       rollback ();
 
+    private:
+      void
+      autocommit (bool);
+
+      // Return false if there is no transaction to end on the server.
+      //
+      bool
+      active () const;
+
     private:
       connection_ptr connection_;
+      transaction_options options_;
     };
   }
 }
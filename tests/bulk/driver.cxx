@@ -0,0 +1,1178 @@
+// file      : tests/bulk/driver.cxx
+// license   : GNU GPL v2; see accompanying LICENSE file
+
+// Test the batch execution of the insert, update, and delete statements
+// through object_statements as well as the database bulk operations. The
+// object traits (including the bulk functions) are written by hand since
+// the ODB compiler does not generate bulk operations support for MySQL.
+// The statement forms for composite conditions are tested by using the
+// statements directly.
+//
+// This test requires a database. Pass the connection options (see
+// database::print_usage()) on the command line. Without any options the
+// test does nothing.
+
+#include <string>
+#include <sstream>
+#include <cassert>
+#include <cstddef> // std::size_t
+#include <cstring> // std::memset, std::memcpy
+
+#include <odb/callback.hxx>
+#include <odb/exceptions.hxx>
+#include <odb/cache-traits.hxx>
+
+#include <odb/mysql/database.hxx>
+#include <odb/mysql/connection.hxx>
+#include <odb/mysql/transaction.hxx>
+#include <odb/mysql/statement-cache.hxx>
+#include <odb/mysql/simple-object-statements.hxx>
+
+using namespace odb::mysql;
+
+struct object
+{
+  object (): id (0), num (0) {}
+  object (unsigned long long i, int n): id (i), num (n) {}
+
+  unsigned long long id;
+  int num;
+};
+
+// Same as above but with an auto-assigned id.
+//
+struct auto_object
+{
+  auto_object (): id (0), num (0) {}
+  explicit auto_object (int n): id (0), num (n) {}
+
+  unsigned long long id;
+  int num;
+};
+
+// Same as object but with optimistic concurrency.
+//
+struct versioned_object
+{
+  versioned_object (): id (0), num (0), ver (0) {}
+  versioned_object (unsigned long long i, int n, unsigned long long v)
+      : id (i), num (n), ver (v) {}
+
+  unsigned long long id;
+  int num;
+  unsigned long long ver;
+};
+
+namespace odb
+{
+  template <>
+  struct class_traits<object>
+  {
+    static const class_kind kind = class_object;
+  };
+
+  template <>
+  struct class_traits<auto_object>
+  {
+    static const class_kind kind = class_object;
+  };
+
+  template <>
+  struct class_traits<versioned_object>
+  {
+    static const class_kind kind = class_object;
+  };
+
+  template <>
+  class access::object_traits<object>
+  {
+  public:
+    typedef ::object object_type;
+    typedef ::object* pointer_type;
+    typedef odb::pointer_traits<pointer_type> pointer_traits;
+
+    static const bool polymorphic = false;
+
+    typedef unsigned long long id_type;
+
+    static const bool auto_id = false;
+
+    static const bool abstract = false;
+
+    static id_type
+    id (const object_type& o) {return o.id;}
+
+    typedef
+    no_op_pointer_cache_traits<pointer_type>
+    pointer_cache_traits;
+
+    typedef
+    no_op_reference_cache_traits<object_type>
+    reference_cache_traits;
+
+    static void
+    callback (database&, object_type&, callback_event) {}
+
+    static void
+    callback (database&, const object_type&, callback_event) {}
+  };
+
+  template <>
+  class access::object_traits<auto_object>
+  {
+  public:
+    typedef ::auto_object object_type;
+    typedef ::auto_object* pointer_type;
+    typedef odb::pointer_traits<pointer_type> pointer_traits;
+
+    static const bool polymorphic = false;
+
+    typedef unsigned long long id_type;
+
+    static const bool auto_id = true;
+
+    static const bool abstract = false;
+
+    static id_type
+    id (const object_type& o) {return o.id;}
+
+    typedef
+    no_op_pointer_cache_traits<pointer_type>
+    pointer_cache_traits;
+
+    typedef
+    no_op_reference_cache_traits<object_type>
+    reference_cache_traits;
+
+    static void
+    callback (database&, object_type&, callback_event) {}
+
+    static void
+    callback (database&, const object_type&, callback_event) {}
+  };
+
+  template <>
+  class access::object_traits<versioned_object>
+  {
+  public:
+    typedef ::versioned_object object_type;
+    typedef ::versioned_object* pointer_type;
+    typedef odb::pointer_traits<pointer_type> pointer_traits;
+
+    static const bool polymorphic = false;
+
+    typedef unsigned long long id_type;
+    typedef unsigned long long version_type;
+
+    static const bool auto_id = false;
+
+    static const bool abstract = false;
+
+    static id_type
+    id (const object_type& o) {return o.id;}
+
+    static const version_type&
+    version (const object_type& o) {return o.ver;}
+
+    typedef
+    no_op_pointer_cache_traits<pointer_type>
+    pointer_cache_traits;
+
+    typedef
+    no_op_reference_cache_traits<object_type>
+    reference_cache_traits;
+
+    static void
+    callback (database&, object_type&, callback_event) {}
+
+    static void
+    callback (database&, const object_type&, callback_event) {}
+  };
+
+  // The image types, binding, and column counts are the same for object
+  // and auto_object.
+  //
+  template <typename O>
+  struct object_image_traits
+  {
+    struct id_image_type
+    {
+      unsigned long long id_value;
+      my_bool id_null;
+
+      std::size_t version;
+    };
+
+    struct image_type
+    {
+      unsigned long long id_value;
+      my_bool id_null;
+
+      int num_value;
+      my_bool num_null;
+
+      std::size_t version;
+    };
+
+    struct extra_statement_cache_type
+    {
+      extra_statement_cache_type (mysql::connection&,
+                                  image_type&,
+                                  id_image_type&,
+                                  mysql::binding&,
+                                  mysql::binding&)
+      {
+      }
+    };
+
+    static void
+    bind (MYSQL_BIND* b, image_type& i, mysql::statement_kind sk)
+    {
+      std::size_t n (0);
+
+      if (sk != mysql::statement_update)
+      {
+        b[n].buffer_type = MYSQL_TYPE_LONGLONG;
+        b[n].is_unsigned = 1;
+        b[n].buffer = &i.id_value;
+        b[n].is_null = &i.id_null;
+        n++;
+      }
+
+      b[n].buffer_type = MYSQL_TYPE_LONG;
+      b[n].is_unsigned = 0;
+      b[n].buffer = &i.num_value;
+      b[n].is_null = &i.num_null;
+    }
+
+    static void
+    bind (MYSQL_BIND* b, id_image_type& i)
+    {
+      b[0].buffer_type = MYSQL_TYPE_LONGLONG;
+      b[0].is_unsigned = 1;
+      b[0].buffer = &i.id_value;
+      b[0].is_null = &i.id_null;
+    }
+
+    static void
+    init (image_type& i, const O& o)
+    {
+      // If the id is auto-assigned, let the server assign it by inserting
+      // NULL.
+      //
+      i.id_value = o.id;
+      i.id_null = access::object_traits<O>::auto_id;
+      i.num_value = o.num;
+      i.num_null = 0;
+    }
+
+    static void
+    init (id_image_type& i, const unsigned long long& id)
+    {
+      i.id_value = id;
+      i.id_null = 0;
+    }
+
+    static const std::size_t batch = 5UL;
+
+    static const std::size_t column_count = 2UL;
+    static const std::size_t id_column_count = 1UL;
+    static const std::size_t inverse_column_count = 0UL;
+    static const std::size_t readonly_column_count = 0UL;
+    static const std::size_t managed_optimistic_column_count = 0UL;
+
+    static const std::size_t separate_load_column_count = 0UL;
+    static const std::size_t separate_update_column_count = 0UL;
+
+    static const bool versioned = false;
+  };
+
+  template <>
+  class access::object_traits_impl<object, id_mysql>:
+    public access::object_traits<object>,
+    public object_image_traits<object>
+  {
+  public:
+    typedef mysql::object_statements<object_type> statements_type;
+
+    // Bulk functions (see database::persist(), update(), and erase() for
+    // ranges).
+    //
+    static void
+    persist (database&,
+             const object_type**,
+             std::size_t,
+             multiple_exceptions&);
+
+    static void
+    erase (database&,
+           const id_type**,
+           std::size_t,
+           multiple_exceptions&);
+
+    static void
+    erase (database&,
+           const object_type**,
+           std::size_t,
+           multiple_exceptions&);
+
+    static void
+    update (database&,
+            const object_type**,
+            std::size_t,
+            multiple_exceptions&);
+
+    static const char persist_statement[];
+    static const char find_statement[];
+    static const char update_statement[];
+    static const char erase_statement[];
+  };
+
+  template <>
+  class access::object_traits_impl<auto_object, id_mysql>:
+    public access::object_traits<auto_object>,
+    public object_image_traits<auto_object>
+  {
+  public:
+    typedef mysql::object_statements<object_type> statements_type;
+
+    static void
+    persist (database&,
+             const object_type**,
+             std::size_t,
+             multiple_exceptions&);
+
+    static const char persist_statement[];
+    static const char find_statement[];
+    static const char update_statement[];
+    static const char erase_statement[];
+  };
+
+  // Only update is supported for this object.
+  //
+  template <>
+  class access::object_traits_impl<versioned_object, id_mysql>:
+    public access::object_traits<versioned_object>
+  {
+  public:
+    typedef mysql::object_statements<object_type> statements_type;
+
+    // The version is part of the id image since it is bound after the id
+    // in the update statement.
+    //
+    struct id_image_type
+    {
+      unsigned long long id_value;
+      my_bool id_null;
+
+      unsigned long long version_value;
+      my_bool version_null;
+
+      std::size_t version;
+    };
+
+    struct image_type
+    {
+      unsigned long long id_value;
+      my_bool id_null;
+
+      int num_value;
+      my_bool num_null;
+
+      unsigned long long version_value;
+      my_bool version_null;
+
+      std::size_t version;
+    };
+
+    struct extra_statement_cache_type
+    {
+      extra_statement_cache_type (mysql::connection&,
+                                  image_type&,
+                                  id_image_type&,
+                                  mysql::binding&,
+                                  mysql::binding&)
+      {
+      }
+    };
+
+    static void
+    bind (MYSQL_BIND* b, image_type& i, mysql::statement_kind sk)
+    {
+      assert (sk == mysql::statement_update);
+
+      b[0].buffer_type = MYSQL_TYPE_LONG;
+      b[0].is_unsigned = 0;
+      b[0].buffer = &i.num_value;
+      b[0].is_null = &i.num_null;
+    }
+
+    static void
+    bind (MYSQL_BIND* b, id_image_type& i)
+    {
+      b[0].buffer_type = MYSQL_TYPE_LONGLONG;
+      b[0].is_unsigned = 1;
+      b[0].buffer = &i.id_value;
+      b[0].is_null = &i.id_null;
+
+      b[1].buffer_type = MYSQL_TYPE_LONGLONG;
+      b[1].is_unsigned = 1;
+      b[1].buffer = &i.version_value;
+      b[1].is_null = &i.version_null;
+    }
+
+    static void
+    init (image_type& i, const object_type& o)
+    {
+      i.id_value = o.id;
+      i.id_null = 0;
+      i.num_value = o.num;
+      i.num_null = 0;
+      i.version_value = o.ver;
+      i.version_null = 0;
+    }
+
+    static void
+    init (id_image_type& i, const id_type& id, const version_type& v)
+    {
+      i.id_value = id;
+      i.id_null = 0;
+      i.version_value = v;
+      i.version_null = 0;
+    }
+
+    static void
+    update (database&,
+            const object_type**,
+            std::size_t,
+            multiple_exceptions&);
+
+    static const std::size_t batch = 5UL;
+
+    static const std::size_t column_count = 3UL;
+    static const std::size_t id_column_count = 1UL;
+    static const std::size_t inverse_column_count = 0UL;
+    static const std::size_t readonly_column_count = 0UL;
+    static const std::size_t managed_optimistic_column_count = 1UL;
+
+    static const std::size_t separate_load_column_count = 0UL;
+    static const std::size_t separate_update_column_count = 0UL;
+
+    static const bool versioned = false;
+
+    static const char update_statement[];
+  };
+
+  const char access::object_traits_impl<object, id_mysql>::
+  persist_statement[] =
+  "INSERT INTO `odb_bulk` (`id`, `num`) VALUES (?, ?)";
+
+  const char access::object_traits_impl<object, id_mysql>::
+  find_statement[] =
+  "SELECT `odb_bulk`.`id`, `odb_bulk`.`num` FROM `odb_bulk` "
+  "WHERE `odb_bulk`.`id`=?";
+
+  const char access::object_traits_impl<object, id_mysql>::
+  update_statement[] =
+  "UPDATE `odb_bulk` SET `num`=? WHERE `id`=?";
+
+  const char access::object_traits_impl<object, id_mysql>::
+  erase_statement[] =
+  "DELETE FROM `odb_bulk` WHERE `id`=?";
+
+  const char access::object_traits_impl<auto_object, id_mysql>::
+  persist_statement[] =
+  "INSERT INTO `odb_bulk_a` (`id`, `num`) VALUES (?, ?)";
+
+  const char access::object_traits_impl<auto_object, id_mysql>::
+  find_statement[] =
+  "SELECT `odb_bulk_a`.`id`, `odb_bulk_a`.`num` FROM `odb_bulk_a` "
+  "WHERE `odb_bulk_a`.`id`=?";
+
+  const char access::object_traits_impl<auto_object, id_mysql>::
+  update_statement[] =
+  "UPDATE `odb_bulk_a` SET `num`=? WHERE `id`=?";
+
+  const char access::object_traits_impl<auto_object, id_mysql>::
+  erase_statement[] =
+  "DELETE FROM `odb_bulk_a` WHERE `id`=?";
+
+  const char access::object_traits_impl<versioned_object, id_mysql>::
+  update_statement[] =
+  "UPDATE `odb_bulk_v` SET `num`=?, `ver`=`ver`+1 "
+  "WHERE `id`=? AND `ver`=?";
+
+  // Bind the images of the first n objects for insertion and execute
+  // the persist statement. Return the number of objects attempted.
+  //
+  template <typename O>
+  static std::size_t
+  persist_ (mysql::object_statements<O>& sts,
+            const O** objs,
+            std::size_t n,
+            multiple_exceptions& mex)
+  {
+    typedef access::object_traits_impl<O, id_mysql> traits;
+
+    mysql::binding& b (sts.insert_image_binding ());
+
+    for (std::size_t i (0); i != n; ++i)
+    {
+      traits::init (sts.image (i), *objs[i]);
+      traits::bind (b.bind + i * mysql::object_statements<O>::
+                      insert_column_count,
+                    sts.image (i),
+                    mysql::statement_insert);
+    }
+
+    b.version++;
+
+    // The auto-assigned ids are returned in the id images.
+    //
+    if (traits::auto_id)
+    {
+      mysql::binding& ib (sts.id_image_binding ());
+      traits::bind (ib.bind, sts.id_image ());
+      ib.version++;
+    }
+
+    mysql::insert_statement& st (sts.persist_statement ());
+    n = st.execute (n, &mex);
+
+    for (std::size_t i (0); i != n; ++i)
+    {
+      if (mex[i] != 0) // Pending exception.
+        continue;
+
+      if (!st.result (i))
+        mex.insert (i, object_already_persistent ());
+    }
+
+    return n;
+  }
+
+  // Bind the images of the first n objects for update and execute the
+  // update statement. Record e for the objects that were not updated.
+  // Return the number of objects attempted.
+  //
+  template <typename O>
+  static std::size_t
+  update_ (mysql::object_statements<O>& sts,
+           const O** objs,
+           std::size_t n,
+           multiple_exceptions& mex,
+           const odb::exception& e)
+  {
+    typedef access::object_traits_impl<O, id_mysql> traits;
+
+    // The update binding uses the skip layout so we only bind the first
+    // object and id images.
+    //
+    mysql::binding& b (sts.update_image_binding ());
+
+    for (std::size_t i (0); i != n; ++i)
+      traits::init (sts.image (i), *objs[i]);
+
+    traits::bind (b.bind, sts.image (), mysql::statement_update);
+    traits::bind (b.bind + mysql::object_statements<O>::update_column_count,
+                  sts.id_image ());
+    b.version++;
+
+    mysql::update_statement& st (sts.update_statement ());
+    n = st.execute (n, &mex);
+
+    for (std::size_t i (0); i != n; ++i)
+    {
+      if (mex[i] != 0) // Pending exception.
+        continue;
+
+      // If only some of the rows in a chunk were found, then we don't
+      // know which.
+      //
+      unsigned long long r (st.result (i));
+
+      if (r != 1)
+        mex.insert (i, r == mysql::update_statement::result_unknown, e);
+    }
+
+    return n;
+  }
+
+  void access::object_traits_impl<object, id_mysql>::
+  persist (database& db,
+           const object_type** objs,
+           std::size_t n,
+           multiple_exceptions& mex)
+  {
+    mysql::connection& c (mysql::transaction::current ().connection (db));
+    persist_ (c.statement_cache ().find_object<object_type> (),
+              objs, n, mex);
+  }
+
+  void access::object_traits_impl<object, id_mysql>::
+  erase (database& db,
+         const id_type** ids,
+         std::size_t n,
+         multiple_exceptions& mex)
+  {
+    mysql::connection& c (mysql::transaction::current ().connection (db));
+    statements_type& sts (c.statement_cache ().find_object<object_type> ());
+
+    mysql::binding& b (sts.id_image_binding ());
+
+    for (std::size_t i (0); i != n; ++i)
+      init (sts.id_image (i), *ids[i]);
+
+    bind (b.bind, sts.id_image ());
+    b.version++;
+
+    mysql::delete_statement& st (sts.erase_statement ());
+    n = st.execute (n, &mex);
+
+    for (std::size_t i (0); i != n; ++i)
+    {
+      if (mex[i] != 0) // Pending exception.
+        continue;
+
+      // If only some of the rows in a chunk were found, then we don't
+      // know which.
+      //
+      unsigned long long r (st.result (i));
+
+      if (r != 1)
+        mex.insert (i,
+                    r == mysql::delete_statement::result_unknown,
+                    object_not_persistent ());
+    }
+  }
+
+  void access::object_traits_impl<object, id_mysql>::
+  erase (database& db,
+         const object_type** objs,
+         std::size_t n,
+         multiple_exceptions& mex)
+  {
+    id_type a[batch];
+    const id_type* ids[batch];
+
+    for (std::size_t i (0); i != n; ++i)
+    {
+      a[i] = id (*objs[i]);
+      ids[i] = &a[i];
+    }
+
+    erase (db, ids, n, mex);
+  }
+
+  void access::object_traits_impl<object, id_mysql>::
+  update (database& db,
+          const object_type** objs,
+          std::size_t n,
+          multiple_exceptions& mex)
+  {
+    mysql::connection& c (mysql::transaction::current ().connection (db));
+    statements_type& sts (c.statement_cache ().find_object<object_type> ());
+
+    for (std::size_t i (0); i != n; ++i)
+      init (sts.id_image (i), id (*objs[i]));
+
+    update_ (sts, objs, n, mex, object_not_persistent ());
+  }
+
+  void access::object_traits_impl<versioned_object, id_mysql>::
+  update (database& db,
+          const object_type** objs,
+          std::size_t n,
+          multiple_exceptions& mex)
+  {
+    mysql::connection& c (mysql::transaction::current ().connection (db));
+    statements_type& sts (c.statement_cache ().find_object<object_type> ());
+
+    for (std::size_t i (0); i != n; ++i)
+      init (sts.id_image (i), id (*objs[i]), version (*objs[i]));
+
+    // With optimistic concurrency a row that is not found is assumed to
+    // have been changed (or erased) by someone else.
+    //
+    n = update_ (sts, objs, n, mex, object_changed ());
+
+    for (std::size_t i (0); i != n; ++i)
+    {
+      if (mex[i] == 0)
+        const_cast<object_type*> (objs[i])->ver++;
+    }
+  }
+
+  void access::object_traits_impl<auto_object, id_mysql>::
+  persist (database& db,
+           const object_type** objs,
+           std::size_t n,
+           multiple_exceptions& mex)
+  {
+    mysql::connection& c (mysql::transaction::current ().connection (db));
+    statements_type& sts (c.statement_cache ().find_object<object_type> ());
+
+    n = persist_ (sts, objs, n, mex);
+
+    for (std::size_t i (0); i != n; ++i)
+    {
+      if (mex[i] == 0)
+        const_cast<object_type*> (objs[i])->id = sts.id_image (i).id_value;
+    }
+  }
+}
+
+typedef odb::access::object_traits_impl<object, odb::id_mysql> traits;
+typedef object_statements<object> statements;
+
+static std::size_t
+persist (statements& sts, const object* objs, std::size_t n)
+{
+  binding& b (sts.insert_image_binding ());
+
+  for (std::size_t i (0); i != n; ++i)
+  {
+    traits::init (sts.image (i), objs[i]);
+    traits::bind (b.bind + i * statements::insert_column_count,
+                  sts.image (i),
+                  statement_insert);
+  }
+
+  b.version++;
+  return sts.persist_statement ().execute (n);
+}
+
+static std::size_t
+update (statements& sts, const object* objs, std::size_t n)
+{
+  binding& b (sts.update_image_binding ());
+
+  for (std::size_t i (0); i != n; ++i)
+  {
+    traits::init (sts.image (i), objs[i]);
+    traits::init (sts.id_image (i), objs[i].id);
+  }
+
+  // The update binding uses the skip layout so we only bind the first
+  // object and id images.
+  //
+  traits::bind (b.bind, sts.image (), statement_update);
+  traits::bind (b.bind + statements::update_column_count, sts.id_image ());
+
+  b.version++;
+  return sts.update_statement ().execute (n);
+}
+
+static std::size_t
+erase (statements& sts, const unsigned long long* ids, std::size_t n)
+{
+  binding& b (sts.id_image_binding ());
+
+  for (std::size_t i (0); i != n; ++i)
+    traits::init (sts.id_image (i), ids[i]);
+
+  traits::bind (b.bind, sts.id_image ());
+
+  b.version++;
+  return sts.erase_statement ().execute (n);
+}
+
+// Bind n INT parameters that are laid out one set after another.
+//
+static void
+bind_int (MYSQL_BIND* b, int* v, std::size_t n)
+{
+  std::memset (b, 0, sizeof (MYSQL_BIND) * n);
+
+  for (std::size_t i (0); i != n; ++i)
+  {
+    b[i].buffer_type = MYSQL_TYPE_LONG;
+    b[i].buffer = v + i;
+  }
+}
+
+int
+main (int argc, char* argv[])
+{
+  if (argc == 1)
+    return 0;
+
+  database db (argc, argv);
+
+  connection_ptr c (db.connection ());
+
+  c->execute ("CREATE TEMPORARY TABLE `odb_bulk` ("
+              "`id` BIGINT UNSIGNED NOT NULL PRIMARY KEY,"
+              "`num` INT NOT NULL) ENGINE=InnoDB");
+
+  c->execute ("CREATE TEMPORARY TABLE `odb_bulk_c` ("
+              "`a` INT NOT NULL,"
+              "`b` INT NOT NULL,"
+              "`num` INT NOT NULL,"
+              "`tag` VARCHAR(16) NOT NULL,"
+              "PRIMARY KEY (`a`, `b`)) ENGINE=InnoDB");
+
+  c->execute ("CREATE TEMPORARY TABLE `odb_bulk_a` ("
+              "`id` BIGINT UNSIGNED NOT NULL AUTO_INCREMENT PRIMARY KEY,"
+              "`num` INT NOT NULL) ENGINE=InnoDB");
+
+  c->execute ("CREATE TEMPORARY TABLE `odb_bulk_v` ("
+              "`id` BIGINT UNSIGNED NOT NULL PRIMARY KEY,"
+              "`num` INT NOT NULL,"
+              "`ver` BIGINT UNSIGNED NOT NULL) ENGINE=InnoDB");
+
+  statements sts (*c);
+  transaction t (c->begin ());
+
+  // Persist one full batch (a chunk of four and a single row).
+  //
+  {
+    const object objs[] = {
+      object (1, 1), object (2, 2), object (3, 3), object (4, 4),
+      object (5, 5)};
+
+    assert (persist (sts, objs, 5) == 5);
+
+    insert_statement& st (sts.persist_statement ());
+    for (std::size_t i (0); i != 5; ++i)
+      assert (st.result (i));
+  }
+
+  // Duplicates in the chunk of four are found by inserting its rows one
+  // at a time.
+  //
+  {
+    const object objs[] = {
+      object (4, 4), object (6, 6), object (5, 5), object (7, 7),
+      object (8, 8)};
+
+    assert (persist (sts, objs, 5) == 5);
+
+    insert_statement& st (sts.persist_statement ());
+    assert (!st.result (0));
+    assert (st.result (1));
+    assert (!st.result (2));
+    assert (st.result (3));
+    assert (st.result (4));
+  }
+
+  // A partial batch (a chunk of two and a single row).
+  //
+  {
+    const object objs[] = {object (9, 9), object (10, 10), object (3, 3)};
+
+    assert (persist (sts, objs, 3) == 3);
+
+    insert_statement& st (sts.persist_statement ());
+    assert (st.result (0));
+    assert (st.result (1));
+    assert (!st.result (2));
+  }
+
+  // Update. If only some of the rows in a chunk are found, then the
+  // result for this chunk is unknown.
+  //
+  {
+    const object objs[] = {
+      object (1, 10), object (2, 20), object (3, 30), object (4, 40),
+      object (11, 110)};
+
+    assert (update (sts, objs, 5) == 5);
+
+    update_statement& st (sts.update_statement ());
+    for (std::size_t i (0); i != 4; ++i)
+      assert (st.result (i) == 1);
+    assert (st.result (4) == 0);
+  }
+
+  {
+    const object objs[] = {
+      object (12, 0), object (5, 50), object (13, 0), object (6, 60)};
+
+    assert (update (sts, objs, 4) == 4);
+
+    update_statement& st (sts.update_statement ());
+    for (std::size_t i (0); i != 4; ++i)
+      assert (st.result (i) == update_statement::result_unknown);
+  }
+
+  // Erase.
+  //
+  {
+    const unsigned long long ids[] = {1, 2, 3, 4, 14};
+
+    assert (erase (sts, ids, 5) == 5);
+
+    delete_statement& st (sts.erase_statement ());
+    for (std::size_t i (0); i != 4; ++i)
+      assert (st.result (i) == 1);
+    assert (st.result (4) == 0);
+  }
+
+  {
+    const unsigned long long ids[] = {15, 16};
+
+    assert (erase (sts, ids, 2) == 2);
+
+    delete_statement& st (sts.erase_statement ());
+    assert (st.result (0) == 0);
+    assert (st.result (1) == 0);
+  }
+
+  // Ids 5 to 10 are left.
+  //
+  assert (c->execute ("DELETE FROM `odb_bulk`") == 6);
+
+  // A composite condition and expressions with nested parenthesis and
+  // quoted separators. The chunk statements use the CASE WHEN and OR
+  // forms rather than the simple CASE and IN.
+  //
+  c->execute ("INSERT INTO `odb_bulk_c` VALUES "
+              "(1, 1, 0, ''), (1, 2, 0, ''), (2, 1, 0, '')");
+
+  {
+    const int sets[3][4] = { // num, tag, a, b
+      {10, 1, 1, 1}, {20, 2, 1, 2}, {30, 3, 3, 3}};
+
+    int v[4][4];
+    MYSQL_BIND b[4 * 4];
+    unsigned long long s[4];
+
+    bind_int (b, &v[0][0], 4 * 4);
+    std::memcpy (v, sets, sizeof (sets));
+
+    binding pb (b, 4, 4, 0, s);
+    pb.version++;
+
+    update_statement st (
+      *c,
+      "UPDATE `odb_bulk_c` SET `num`=CAST(? AS SIGNED), "
+      "`tag`=CONCAT('x,(', ?) WHERE `a`=? AND `b`=?",
+      false,
+      pb);
+
+    assert (st.execute (3) == 3);
+    assert (st.result (0) == 1);
+    assert (st.result (1) == 1);
+    assert (st.result (2) == 0);
+
+    assert (c->execute ("SELECT 1 FROM `odb_bulk_c` WHERE "
+                        "(`a`=1 AND `b`=1 AND `num`=10 AND `tag`='x,(1') OR "
+                        "(`a`=1 AND `b`=2 AND `num`=20 AND `tag`='x,(2') OR "
+                        "(`a`=2 AND `b`=1 AND `num`=0 AND `tag`='')") == 3);
+  }
+
+  {
+    int v[4][2];
+    MYSQL_BIND b[4 * 2];
+    unsigned long long s[4];
+
+    bind_int (b, &v[0][0], 4 * 2);
+
+    binding pb (b, 2, 4, 0, s);
+
+    delete_statement st (
+      *c, "DELETE FROM `odb_bulk_c` WHERE `a`=? AND `b`=?", pb);
+
+    // A chunk of two and a single row.
+    //
+    {
+      const int sets[3][2] = {{1, 1}, {1, 2}, {7, 7}};
+      std::memcpy (v, sets, sizeof (sets));
+      pb.version++;
+
+      assert (st.execute (3) == 3);
+      assert (st.result (0) == 1);
+      assert (st.result (1) == 1);
+      assert (st.result (2) == 0);
+    }
+
+    // A chunk of four with only one row found.
+    //
+    {
+      const int sets[4][2] = {{2, 1}, {6, 6}, {7, 7}, {8, 8}};
+      std::memcpy (v, sets, sizeof (sets));
+      pb.version++;
+
+      assert (st.execute (4) == 4);
+      for (std::size_t i (0); i != 4; ++i)
+        assert (st.result (i) == delete_statement::result_unknown);
+    }
+
+    assert (c->execute ("SELECT 1 FROM `odb_bulk_c`") == 0);
+  }
+
+  // Bulk persist through the database. With the batch of five a range of
+  // seven objects is inserted as chunks of four, one, and two. The ids
+  // assigned to each chunk continue those of the previous one.
+  //
+  {
+    auto_object objs[] = {
+      auto_object (1), auto_object (2), auto_object (3), auto_object (4),
+      auto_object (5), auto_object (6), auto_object (7)};
+
+    db.persist (objs, objs + 7);
+
+    unsigned long long inc (c->auto_increment_increment ());
+
+    for (std::size_t i (0); i != 7; ++i)
+    {
+      assert (objs[i].id == objs[0].id + i * inc);
+
+      std::ostringstream os;
+      os << "SELECT 1 FROM `odb_bulk_a` WHERE `id`=" << objs[i].id
+         << " AND `num`=" << objs[i].num;
+
+      assert (c->execute (os.str ()) == 1);
+    }
+  }
+
+  // Duplicates in the first and second batch are reported at their
+  // positions in the range and the other objects are persisted.
+  //
+  {
+    c->execute ("INSERT INTO `odb_bulk` VALUES (23, 0), (26, 0)");
+
+    const object objs[] = {
+      object (21, 1), object (22, 2), object (23, 3), object (24, 4),
+      object (25, 5), object (26, 6), object (27, 7)};
+
+    try
+    {
+      db.persist (objs, objs + 7);
+      assert (false);
+    }
+    catch (const odb::multiple_exceptions& e)
+    {
+      assert (e.attempted () == 7);
+      assert (e.size () == 2);
+
+      for (std::size_t i (0); i != 7; ++i)
+        assert ((e[i] != 0) == (i == 2 || i == 5));
+
+      assert (dynamic_cast<const odb::object_already_persistent*> (
+                &e[2]->exception ()) != 0);
+      assert (dynamic_cast<const odb::object_already_persistent*> (
+                &e[5]->exception ()) != 0);
+    }
+
+    assert (c->execute ("SELECT 1 FROM `odb_bulk` WHERE `num`!=0") == 5);
+  }
+
+  // Bulk erase through the database. The missing object is the single
+  // row chunk of the first batch so it is reported for certain.
+  //
+  {
+    c->execute ("INSERT INTO `odb_bulk` VALUES "
+                "(31, 0), (32, 0), (33, 0), (34, 0), (36, 0), (37, 0)");
+
+    const unsigned long long ids[] = {31, 32, 33, 34, 35, 36, 37};
+
+    try
+    {
+      db.erase<object> (ids, ids + 7);
+      assert (false);
+    }
+    catch (const odb::multiple_exceptions& e)
+    {
+      assert (e.attempted () == 7);
+      assert (e.size () == 1);
+      assert (e[4] != 0 && !e[4]->maybe ());
+      assert (dynamic_cast<const odb::object_not_persistent*> (
+                &e[4]->exception ()) != 0);
+    }
+
+    assert (c->execute ("SELECT 1 FROM `odb_bulk` WHERE `id`>30") == 0);
+  }
+
+  // If the missing object shares the IN chunk with an existing one, then
+  // both may have not been persistent.
+  //
+  {
+    c->execute ("INSERT INTO `odb_bulk` VALUES (41, 0), (43, 0)");
+
+    const object objs[] = {object (41, 0), object (42, 0), object (43, 0)};
+
+    try
+    {
+      db.erase (objs, objs + 3);
+      assert (false);
+    }
+    catch (const odb::multiple_exceptions& e)
+    {
+      assert (e.attempted () == 3);
+      assert (e.size () == 2);
+      assert (e[0] != 0 && e[0]->maybe ());
+      assert (e[1] != 0 && e[1]->maybe ());
+      assert (e[2] == 0);
+    }
+
+    assert (c->execute ("SELECT 1 FROM `odb_bulk` WHERE `id`>40") == 0);
+  }
+
+  // Bulk update through the database. The objects are updated as chunks
+  // of four and one (the missing object) and then one.
+  //
+  {
+    c->execute ("INSERT INTO `odb_bulk` VALUES "
+                "(51, 0), (52, 0), (53, 0), (54, 0), (56, 0)");
+
+    const object objs[] = {
+      object (51, 1), object (52, 2), object (53, 3), object (54, 4),
+      object (55, 5), object (56, 6)};
+
+    try
+    {
+      db.update (objs, objs + 6);
+      assert (false);
+    }
+    catch (const odb::multiple_exceptions& e)
+    {
+      assert (e.attempted () == 6);
+      assert (e.size () == 1);
+      assert (e[4] != 0 && !e[4]->maybe ());
+      assert (dynamic_cast<const odb::object_not_persistent*> (
+                &e[4]->exception ()) != 0);
+    }
+
+    assert (c->execute ("SELECT 1 FROM `odb_bulk` "
+                        "WHERE `id`>50 AND `num`=`id`-50") == 5);
+  }
+
+  // A stale object (with an old version) is reported as changed. The
+  // chunk of two uses the CASE WHEN form with the version in the WHERE
+  // condition only.
+  //
+  {
+    c->execute ("INSERT INTO `odb_bulk_v` VALUES "
+                "(1, 0, 1), (2, 0, 2), (3, 0, 1)");
+
+    versioned_object objs[] = {
+      versioned_object (1, 1, 1),
+      versioned_object (3, 3, 1),
+      versioned_object (2, 2, 1)};
+
+    try
+    {
+      db.update (objs, objs + 3);
+      assert (false);
+    }
+    catch (const odb::multiple_exceptions& e)
+    {
+      assert (e.attempted () == 3);
+      assert (e.size () == 1);
+      assert (e[2] != 0 && !e[2]->maybe ());
+      assert (dynamic_cast<const odb::object_changed*> (
+                &e[2]->exception ()) != 0);
+    }
+
+    assert (objs[0].ver == 2 && objs[1].ver == 2 && objs[2].ver == 1);
+
+    assert (c->execute ("SELECT 1 FROM `odb_bulk_v` WHERE "
+                        "(`id`=1 AND `num`=1 AND `ver`=2) OR "
+                        "(`id`=3 AND `num`=3 AND `ver`=2) OR "
+                        "(`id`=2 AND `num`=0 AND `ver`=2)") == 3);
+  }
+
+  t.commit ();
+}
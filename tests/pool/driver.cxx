@@ -0,0 +1,119 @@
+// file      : tests/pool/driver.cxx
+// license   : GNU GPL v2; see accompanying LICENSE file
+
+// Test that the connection pool spreads the connections used by several
+// threads among its shards.
+//
+// This test requires a database. Pass the connection options (see
+// database::print_usage()) on the command line. Without any options the
+// test does nothing.
+
+#include <cassert>
+#include <cstddef> // std::size_t
+
+#include <odb/details/config.hxx> // ODB_THREADS_*
+
+#ifndef ODB_THREADS_NONE
+#  include <odb/details/lock.hxx>
+#  include <odb/details/mutex.hxx>
+#  include <odb/details/thread.hxx>
+#  include <odb/details/condition.hxx>
+#endif
+
+#include <odb/mysql/database.hxx>
+#include <odb/mysql/connection.hxx>
+#include <odb/mysql/connection-factory.hxx>
+
+using namespace odb::mysql;
+
+#ifndef ODB_THREADS_NONE
+
+struct pool: connection_pool_factory
+{
+  pool (): connection_pool_factory (0, 0, false) {}
+
+  // Number of shards with idle connections.
+  //
+  std::size_t
+  used_shards ()
+  {
+    std::size_t r (0);
+
+    for (std::size_t i (0); i != shard_count; ++i)
+    {
+      odb::details::lock l (shards_[i].mutex);
+
+      if (!shards_[i].idle.empty ())
+        r++;
+    }
+
+    return r;
+  }
+};
+
+static const std::size_t thread_count = 4;
+
+struct task
+{
+  task (database& d): db (d), ready (0), cond (mutex) {}
+
+  database& db;
+
+  std::size_t ready; // Number of threads holding a connection.
+  odb::details::mutex mutex;
+  odb::details::condition cond;
+};
+
+// Hold a connection until all the threads have one so that each of them
+// is established (and returned to the pool) by a different thread.
+//
+static void*
+run (void* arg)
+{
+  task& t (*static_cast<task*> (arg));
+
+  connection_ptr c (t.db.connection ());
+
+  odb::details::lock l (t.mutex);
+
+  if (++t.ready == thread_count)
+    t.cond.signal ();
+
+  while (t.ready != thread_count)
+  {
+    t.cond.wait (l);
+    t.cond.signal (); // Wake up the next waiting thread.
+  }
+
+  return 0;
+}
+
+#endif
+
+int
+main (int argc, char* argv[])
+{
+  if (argc == 1)
+    return 0;
+
+#ifndef ODB_THREADS_NONE
+  pool* f (new pool);
+  database db (argc, argv, false, "", 0, f);
+
+  {
+    task t (db);
+    odb::details::thread* ts[thread_count];
+
+    for (std::size_t i (0); i != thread_count; ++i)
+      ts[i] = new odb::details::thread (&run, &t);
+
+    for (std::size_t i (0); i != thread_count; ++i)
+    {
+      ts[i]->join ();
+      delete ts[i];
+    }
+  }
+
+  assert (f->used_shards () > 1);
+#endif
+}
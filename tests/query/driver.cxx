@@ -0,0 +1,214 @@
+// file      : tests/query/driver.cxx
+// license   : GNU GPL v2; see accompanying LICENSE file
+
+// Test the construction of the native query clause and parameter binding,
+// including the translation of the dynamic (multi-database) queries. This
+// test does not require a database.
+
+#include <string>
+#include <sstream>
+#include <cassert>
+#include <cstddef> // std::size_t
+
+#include <odb/query-dynamic.hxx>
+
+#include <odb/mysql/query.hxx>
+#include <odb/mysql/query-dynamic.hxx>
+
+using namespace std;
+using namespace odb::mysql;
+
+static int
+value (const binding& b, size_t i)
+{
+  assert (b.bind[i].buffer_type == MYSQL_TYPE_LONG);
+  return *static_cast<const int*> (b.bind[i].buffer);
+}
+
+int
+main ()
+{
+  // Appending native parts, columns, and parameters.
+  //
+  {
+    int x (3);
+
+    query_base q ("`a` =");
+    q += query_base::_val (1);
+    q += "AND";
+    q += query_base ("`b` IN (");
+    q += query_base::_val (2);
+    q += ",";
+    q += query_base::_ref (x);
+    q += ")";
+
+    assert (q.clause () == "WHERE `a` = ? AND `b` IN (?, ?)");
+
+    binding& b (q.parameters_binding ());
+    assert (b.count == 3);
+    assert (value (b, 0) == 1);
+    assert (value (b, 1) == 2);
+
+    q.init_parameters ();
+    assert (value (b, 2) == 3);
+
+    x = 4;
+    q.init_parameters ();
+    assert (value (b, 2) == 4);
+
+    // The clause is kept up to date by copying.
+    //
+    query_base c (q);
+    c += "ORDER BY `a`";
+    assert (c.clause () == "WHERE `a` = ? AND `b` IN (?, ?) ORDER BY `a`");
+    assert (q.clause () == "WHERE `a` = ? AND `b` IN (?, ?)");
+
+    query_base t (query_base ("`a` = 1") + query_base ("`b` = 2"));
+    assert (t.clause () == "WHERE `a` = 1 `b` = 2");
+  }
+
+  // Appending empty native parts.
+  //
+  {
+    query_base q ("`a` = 1");
+    q += "";
+    q += string ();
+    assert (q.clause () == "WHERE `a` = 1");
+
+    query_base e ("");
+    e += "ORDER BY `a`";
+    assert (e.clause () == "ORDER BY `a`");
+
+    query_base p ("");
+    p += query_base::_val (1);
+
+    query_base r ("`a` =");
+    r += p;
+    assert (r.clause () == "WHERE `a` = ?");
+  }
+
+  // Optimization of the TRUE literal.
+  //
+  {
+    query_base q (true);
+    q += "ORDER BY `a`";
+    assert (q.clause () == "WHERE TRUE ORDER BY `a`");
+
+    q.optimize ();
+    assert (q.clause () == "ORDER BY `a`");
+
+    query_base t (true);
+    t.optimize ();
+    assert (t.empty ());
+    assert (t.clause ().empty ());
+
+    query_base a (true);
+    a += "AND `a` = 1";
+    a.optimize ();
+    assert (a.clause () == "WHERE TRUE AND `a` = 1");
+  }
+
+  // Logical operators. These reserve space for both sides which may move
+  // the parameter binding array.
+  //
+  {
+    query_base x ("`a` =");
+    x += query_base::_val (1);
+
+    query_base y ("`b` BETWEEN");
+    y += query_base::_val (2);
+    y += "AND";
+    y += query_base::_val (3);
+
+    query_base r (x && y);
+    assert (r.clause () == "WHERE (`a` = ?) AND (`b` BETWEEN ? AND ?)");
+
+    binding& b (r.parameters_binding ());
+    assert (b.count == 3);
+    assert (value (b, 0) == 1);
+    assert (value (b, 1) == 2);
+    assert (value (b, 2) == 3);
+
+    assert ((x || !y).clause () ==
+            "WHERE (`a` = ?) OR (NOT (`b` BETWEEN ? AND ?))");
+
+    // Reserving alone must keep the binding pointing to the current array.
+    //
+    query_base q (x);
+    q.reserve (y, &r);
+
+    binding& qb (q.parameters_binding ());
+    assert (qb.count == 1);
+    assert (value (qb, 0) == 1);
+
+    q += y;
+    assert (qb.count == 3);
+    assert (value (qb, 0) == 1);
+    assert (value (qb, 2) == 3);
+  }
+
+  // Translation of dynamic queries. Queries with the same shape but
+  // different parameter values reuse the translated clause.
+  //
+  {
+    odb::query_column<int> oc;
+    query_column<int, id_long> c (oc, "`t`", "`num`", 0);
+
+    int v (5);
+
+    for (int i (0); i != 3; ++i)
+    {
+      query_base q (oc == i || oc == odb::query_base::_ref (v));
+
+      assert (q.clause () == "WHERE (`t`.`num` = ?) OR (`t`.`num` = ?)");
+
+      q.init_parameters ();
+
+      binding& b (q.parameters_binding ());
+      assert (b.count == 2);
+      assert (value (b, 0) == i);
+      assert (value (b, 1) == v);
+
+      v++;
+    }
+
+    for (int i (0); i != 2; ++i)
+    {
+      query_base q (oc != i);
+      assert (q.clause () == "WHERE `t`.`num` != ?");
+
+      binding& b (q.parameters_binding ());
+      assert (b.count == 1);
+      assert (value (b, 0) == i);
+    }
+
+    // Native parts are part of the shape.
+    //
+    assert (query_base (odb::query_base ("`num` = 1")).clause () ==
+            "WHERE `num` = 1");
+    assert (query_base (odb::query_base ("`num` = 2")).clause () ==
+            "WHERE `num` = 2");
+
+    // Shapes that were evicted from the cache are translated again.
+    //
+    for (size_t i (0); i != 1000; ++i)
+    {
+      ostringstream os;
+      os << "`num` = " << i;
+
+      string n (os.str ());
+      assert (query_base (odb::query_base (n)).clause () == "WHERE " + n);
+    }
+
+    assert (query_base (odb::query_base ("`num` = 1")).clause () ==
+            "WHERE `num` = 1");
+
+    {
+      query_base q (oc == 7 || oc == odb::query_base::_ref (v));
+      assert (q.clause () == "WHERE (`t`.`num` = ?) OR (`t`.`num` = ?)");
+      assert (value (q.parameters_binding (), 0) == 7);
+    }
+
+    assert (query_base (odb::query_base ()).empty ());
+  }
+}